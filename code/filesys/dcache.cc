@@ -0,0 +1,155 @@
+// dcache.cc 
+//	Routines to manage the directory entry cache.
+//
+//	Entries are kept in a hash table, keyed by the directory and
+//	name they translate, and on a list in the order they were
+//	inserted, so that we know which one to throw out when the
+//	cache is full.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "dcache.h"
+
+//----------------------------------------------------------------------
+// DentryKey::operator==
+// 	Two keys are equal if they name the same file in the same
+//	directory.
+//----------------------------------------------------------------------
+
+bool
+DentryKey::operator==(const DentryKey &other) const
+{
+    return (dirSector == other.dirSector) &&
+		!strncmp(name, other.name, FileNameMaxLen);
+}
+
+//----------------------------------------------------------------------
+// DentryGetKey, DentryHash
+// 	Helper routines used by the hash table to find an entry's key,
+//	and to hash a key.
+//----------------------------------------------------------------------
+
+static DentryKey
+DentryGetKey(Dentry *dentry)
+{
+    return dentry->key;
+}
+
+static unsigned
+DentryHash(DentryKey key)
+{
+    return Directory::HashName(key.name) ^ (key.dirSector * 2654435761u);
+}
+
+//----------------------------------------------------------------------
+// MakeKey
+// 	Fill in a key for "name" in directory "dirSector".
+//----------------------------------------------------------------------
+
+static void
+MakeKey(DentryKey *key, int dirSector, char *name)
+{
+    key->dirSector = dirSector;
+    strncpy(key->name, name, FileNameMaxLen);
+    key->name[FileNameMaxLen] = '\0';
+}
+
+//----------------------------------------------------------------------
+// DentryCache::DentryCache
+// 	Initialize an empty dentry cache.
+//
+//	"size" is the maximum number of entries to keep
+//----------------------------------------------------------------------
+
+DentryCache::DentryCache(int size)
+{
+    maxEntries = size;
+    table = new HashTable<DentryKey, Dentry *>(DentryGetKey, DentryHash);
+    age = new List<Dentry *>;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::~DentryCache
+// 	Throw away all cached entries, and de-allocate the cache.
+//----------------------------------------------------------------------
+
+DentryCache::~DentryCache()
+{
+    while (!age->IsEmpty()) {
+	Dentry *dentry = age->RemoveFront();
+	(void) table->Remove(dentry->key);
+	delete dentry;
+    }
+    delete table;
+    delete age;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+// 	Look up "name" in directory "dirSector".  If it is cached,
+//	return TRUE, and the location of its file header in "sector".
+//
+//	"isDirectory" -- set to whether "name" is a directory
+//----------------------------------------------------------------------
+
+bool
+DentryCache::Find(int dirSector, char *name, int *sector, bool *isDirectory)
+{
+    DentryKey key;
+    Dentry *dentry;
+
+    MakeKey(&key, dirSector, name);
+    if (!table->Find(key, &dentry))
+	return FALSE;
+    *sector = dentry->sector;
+    *isDirectory = dentry->isDirectory;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Insert
+// 	Remember that "name" in directory "dirSector" has its file header
+//	at "sector".  If the cache is full, forget the oldest entry.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Insert(int dirSector, char *name, int sector, bool isDirectory)
+{
+    Dentry *dentry;
+
+    Remove(dirSector, name);		// replace any stale translation
+    if ((int) age->NumInList() >= maxEntries) {
+	dentry = age->RemoveFront();
+	(void) table->Remove(dentry->key);
+	delete dentry;
+    }
+    dentry = new Dentry;
+    MakeKey(&dentry->key, dirSector, name);
+    dentry->sector = sector;
+    dentry->isDirectory = isDirectory;
+    table->Insert(dentry);
+    age->Append(dentry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Remove
+// 	Forget the translation for "name" in directory "dirSector",
+//	if we have it.
+//----------------------------------------------------------------------
+
+void
+DentryCache::Remove(int dirSector, char *name)
+{
+    DentryKey key;
+    Dentry *dentry;
+
+    MakeKey(&key, dirSector, name);
+    if (table->Find(key, &dentry)) {
+	(void) table->Remove(key);
+	age->Remove(dentry);
+	delete dentry;
+    }
+}
@@ -0,0 +1,71 @@
+// dcache.h 
+//	Data structures for the directory entry ("dentry") cache.
+//
+//	Resolving a path name means looking up each of its components
+//	in turn, each in a different directory on disk.  The dentry
+//	cache remembers recent translations of <directory, name> to the
+//	sector holding the named file's header, so that resolving the
+//	same names again does not touch the disk.
+//
+//	The cache only holds names that are also on disk; the file
+//	system must call Remove when it removes a name from a directory.
+//	When the cache is full, the oldest entry is thrown out.
+//
+//      We assume mutual exclusion is provided by the caller.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "directory.h"
+#include "hash.h"
+
+// The following class identifies a cached name: the directory it is
+// in, and the name itself.
+
+class DentryKey {
+  public:
+    int dirSector;			// Header sector of the directory
+    char name[FileNameMaxLen + 1];	// Name within that directory
+
+    bool operator==(const DentryKey &other) const;
+};
+
+// The following class defines one cached directory entry.
+
+class Dentry {
+  public:
+    DentryKey key;			// Where the name was looked up
+    int sector;				// Header sector of the named file
+    bool isDirectory;			// Is the named file a directory?
+};
+
+// The following class defines the cache itself.
+
+class DentryCache {
+  public:
+    DentryCache(int size);		// Initialize an empty cache with room
+					// for "size" entries
+    ~DentryCache();			// De-allocate the cache
+
+    bool Find(int dirSector, char *name, int *sector, bool *isDirectory);
+					// Look up "name" in directory
+					// "dirSector"; return FALSE if it
+					// isn't cached
+    void Insert(int dirSector, char *name, int sector, bool isDirectory);
+					// Remember a translation
+    void Remove(int dirSector, char *name);
+					// Forget a translation, if cached
+
+  private:
+    int maxEntries;			// How many entries we keep at most
+    HashTable<DentryKey, Dentry *> *table; // Cached entries, by key
+    List<Dentry *> *age;		// Cached entries, oldest first
+};
+
+#endif // DCACHE_H
@@ -7,13 +7,32 @@
 //	of each directory entry means that we have the restriction
 //	of a fixed maximum size for file names.
 //
+//	The table is organized as a hash table with linear probing.
+//	A name hashes to a "home" slot; if that slot is taken, the
+//	name goes in the next free slot after it (wrapping around),
+//	but no more than MaxProbe slots along, so that a lookup --
+//	including one for a name that isn't there -- never probes more
+//	than MaxProbe entries.
+//
+//	Removing a name leaves a "deleted" marker behind, so that
+//	lookups for names stored further along the probe sequence
+//	still find them; a later Add may re-use the slot.  Markers that
+//	no probe sequence runs through any more (those just before a
+//	slot that has never been used) are cleared at once, and if Add
+//	finds more than half of a name's probe window taken up by them,
+//	the table is re-hashed without them.
+//
 //	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
+//	we use FetchFrom/WriteBack to fetch the contents of the directory
 //	from disk, and to write back any modifications back to disk.
+//	Entries are read from disk lazily, as lookups reach them, and
+//	only modified entries are written back.
 //
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
+//	When the slots near a name's home slot are all taken, the table
+//	is doubled in size and every name re-hashed (doubling again, if
+//	need be, until every name is close to its home slot); the whole
+//	table is then written to new blocks, which the directory file
+//	is switched to when the table is written back.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -23,6 +42,7 @@
 #include "utility.h"
 #include "filehdr.h"
 #include "directory.h"
+#include "debug.h"
 
 //----------------------------------------------------------------------
 // Directory::Directory
@@ -36,10 +56,13 @@
 
 Directory::Directory(int size)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = FALSE;
+    table = NULL;
+    loaded = dirty = NULL;
+    Resize(size);
+    for (int i = 0; i < tableSize; i++) {
+	loaded->Mark(i);		// the empty table is authoritative,
+	dirty->Mark(i);			// and all of it must be written out
+    }
 }
 
 //----------------------------------------------------------------------
@@ -50,11 +73,116 @@ Directory::Directory(int size)
 Directory::~Directory()
 { 
     delete [] table;
+    delete loaded;
+    delete dirty;
 } 
 
+//----------------------------------------------------------------------
+// Directory::Resize
+// 	Throw away the current table, and allocate an empty one of
+//	"size" entries, none of which have been read in yet.
+//----------------------------------------------------------------------
+
+void
+Directory::Resize(int size)
+{
+    ASSERT(size > 0);
+    delete [] table;
+    delete loaded;
+    delete dirty;
+
+    table = new DirectoryEntry[size];
+    tableSize = size;
+    for (int i = 0; i < tableSize; i++) {
+	table[i].inUse = FALSE;
+	table[i].isDirectory = FALSE;
+	table[i].deleted = FALSE;
+    }
+    loaded = new Bitmap(tableSize);
+    dirty = new Bitmap(tableSize);
+    file = NULL;
+    rebuilt = FALSE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Place
+// 	Put a copy of "entry" in the table "entries", of "size" slots,
+//	in the first free slot at most MaxProbe along from its home slot.
+//	Return FALSE if there is none.
+//----------------------------------------------------------------------
+
+bool
+Directory::Place(DirectoryEntry *entries, int size, DirectoryEntry *entry)
+{
+    int home = HashName(entry->name) % size;
+
+    for (int probe = 0; probe < min(size, MaxProbe); probe++) {
+	int i = (home + probe) % size;
+	if (!entries[i].inUse) {
+	    entries[i] = *entry;
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Directory::Rebuild
+// 	Re-hash every name in use into a new table of "size" entries --
+//	or twice that, or more, until every name fits within MaxProbe of
+//	its home slot.  Removed entries are dropped.  Since a name's slot
+//	depends on the size of the table, the whole table must be
+//	written back.
+//
+//	"size" -- the table size to try first; the current size, to
+//		clear out removed entries, or twice it, to make room
+//----------------------------------------------------------------------
+
+void
+Directory::Rebuild(int size)
+{
+    int oldSize = tableSize;
+    DirectoryEntry *old = new DirectoryEntry[oldSize];
+    DirectoryEntry *fresh = NULL;
+    OpenFile *oldFile = file;
+    bool fits = FALSE;
+    int i;
+
+    for (i = 0; i < oldSize; i++)
+	old[i] = *Entry(i);
+    for (; !fits; size *= 2) {
+	delete [] fresh;
+	fresh = new DirectoryEntry[size];
+	for (i = 0; i < size; i++) {
+	    fresh[i].inUse = FALSE;
+	    fresh[i].isDirectory = FALSE;
+	    fresh[i].deleted = FALSE;
+	}
+	fits = TRUE;
+	for (i = 0; (i < oldSize) && fits; i++)
+	    if (old[i].inUse)
+		fits = Place(fresh, size, &old[i]);
+    }
+    size /= 2;				// undo the loop's last doubling
+
+    Resize(size);
+    file = oldFile;
+    for (i = 0; i < tableSize; i++) {
+	table[i] = fresh[i];
+	loaded->Mark(i);		// nothing in the file is current
+	dirty->Mark(i);
+    }
+    rebuilt = TRUE;
+    DEBUG(dbgFile, "Directory re-hashed into " << tableSize << " entries");
+    delete [] old;
+    delete [] fresh;
+}
+
 //----------------------------------------------------------------------
 // Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// 	Prepare to read the contents of the directory from disk.
+//	The table is sized to match the file; individual entries are
+//	read in when they are first needed (see Directory::Entry).
 //
 //	"file" -- file containing the directory contents
 //----------------------------------------------------------------------
@@ -62,12 +190,34 @@ Directory::~Directory()
 void
 Directory::FetchFrom(OpenFile *file)
 {
-    (void) file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    Resize(file->Length() / sizeof(DirectoryEntry));
+    this->file = file;
+}
+
+//----------------------------------------------------------------------
+// Directory::Prepare
+// 	Call before the file system operation that writes back a table
+//	that may have been re-hashed.  A re-hashed table is written out
+//	whole, to new blocks (see OpenFile::WriteAside), since it may be
+//	bigger than the log.  Return FALSE if there isn't room on disk.
+//
+//	"file" -- file to contain the new directory contents
+//----------------------------------------------------------------------
+
+bool
+Directory::Prepare(OpenFile *file)
+{
+    if (!rebuilt)
+	return TRUE;
+    return file->WriteAside((char *)table, tableSize * sizeof(DirectoryEntry));
 }
 
 //----------------------------------------------------------------------
 // Directory::WriteBack
-// 	Write any modifications to the directory back to disk
+// 	Write any modifications to the directory back to disk.
+//	Runs of consecutive changed entries are written with a single
+//	call, through the log (see OpenFile::WriteLogged).  A re-hashed
+//	table was written by Prepare; the file just switches to it.
 //
 //	"file" -- file to contain the new directory contents
 //----------------------------------------------------------------------
@@ -75,7 +225,60 @@ Directory::FetchFrom(OpenFile *file)
 void
 Directory::WriteBack(OpenFile *file)
 {
-    (void) file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int i, first;
+
+    if (rebuilt) {
+	file->Switch();
+	rebuilt = FALSE;
+	for (i = 0; i < tableSize; i++)
+	    dirty->Clear(i);
+	return;
+    }
+    for (i = 0; i < tableSize; i++) {
+	if (!dirty->Test(i))
+	    continue;
+	for (first = i; (i + 1 < tableSize) && dirty->Test(i + 1); i++)
+	    ;
+	(void) file->WriteLogged((char *)&table[first],
+			(i - first + 1) * sizeof(DirectoryEntry),
+			first * sizeof(DirectoryEntry));
+    }
+    for (i = 0; i < tableSize; i++)
+	dirty->Clear(i);
+}
+
+//----------------------------------------------------------------------
+// Directory::Entry
+// 	Return the "i"th entry of the table, reading it in from the
+//	directory file if this is the first time it is needed.
+//----------------------------------------------------------------------
+
+DirectoryEntry *
+Directory::Entry(int i)
+{
+    if (!loaded->Test(i)) {
+	ASSERT(file != NULL);
+	(void) file->ReadAt((char *)&table[i], sizeof(DirectoryEntry),
+					i * sizeof(DirectoryEntry));
+	loaded->Mark(i);
+    }
+    return &table[i];
+}
+
+//----------------------------------------------------------------------
+// Directory::HashName
+// 	Return a hash of a file name (at most FileNameMaxLen characters
+//	of it, the same part that is stored in an entry).
+//----------------------------------------------------------------------
+
+unsigned
+Directory::HashName(char *name)
+{
+    unsigned hash = 5381;
+
+    for (int i = 0; (i < FileNameMaxLen) && (name[i] != '\0'); i++)
+	hash = (hash * 33) ^ (unsigned char) name[i];
+    return hash;
 }
 
 //----------------------------------------------------------------------
@@ -83,15 +286,27 @@ Directory::WriteBack(OpenFile *file)
 // 	Look up file name in directory, and return its location in the table of
 //	directory entries.  Return -1 if the name isn't in the directory.
 //
+//	Start at the name's home slot and probe forward; an entry that
+//	has never been used ends the search, and so does reaching
+//	MaxProbe entries, since Add never puts a name further along.
+//
 //	"name" -- the file name to look up
 //----------------------------------------------------------------------
 
 int
 Directory::FindIndex(char *name)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
+    int home = HashName(name) % tableSize;
+    DirectoryEntry *entry;
+
+    for (int probe = 0; probe < min(tableSize, MaxProbe); probe++) {
+	int i = (home + probe) % tableSize;
+	entry = Entry(i);
+	if (!entry->inUse && !entry->deleted)
+	    break;			// end of the probe sequence
+        if (entry->inUse && !strncmp(entry->name, name, FileNameMaxLen))
 	    return i;
+    }
     return -1;		// name not in directory
 }
 
@@ -102,43 +317,76 @@ Directory::FindIndex(char *name)
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDirectory" -- if not NULL, set to whether "name" is a directory
 //----------------------------------------------------------------------
 
 int
 Directory::Find(char *name)
+{
+    return Find(name, NULL);
+}
+
+int
+Directory::Find(char *name, bool *isDirectory)
 {
     int i = FindIndex(name);
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (i == -1)
+	return -1;
+    if (isDirectory != NULL)
+	*isDirectory = table[i].isDirectory;
+    return table[i].sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return TRUE if successful;
-//	return FALSE if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return FALSE if the file name is already in the directory.
+//	If there is no free slot near the name's home slot, the table
+//	is grown first; if more than half of the slots near it hold
+//	removed entries, the table is re-hashed without them.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the added file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(char *name, int newSector)
+Directory::Add(char *name, int newSector, bool isDirectory)
 { 
+    int home = HashName(name) % tableSize;
+    int window = min(tableSize, MaxProbe);
+    int free = -1, removed = 0;
+    DirectoryEntry *entry;
+
     if (FindIndex(name) != -1)
 	return FALSE;
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = TRUE;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return TRUE;
-	}
-    return FALSE;	// no space.  Fix when we have extensible files.
+    for (int probe = 0; probe < window; probe++) {
+	int i = (home + probe) % tableSize;
+	entry = Entry(i);
+	if (entry->deleted)
+	    removed++;
+	if (!entry->inUse && (free == -1))
+	    free = i;
+    }
+    if (removed > window / 2) {
+	Rebuild(tableSize);	// clear out the removed entries, and
+	return Add(name, newSector, isDirectory);	// try again
+    }
+    if (free == -1) {
+	Rebuild(2 * tableSize);	// no space nearby; make room and
+	return Add(name, newSector, isDirectory);	// try again
+    }
+    entry = &table[free];
+    entry->inUse = TRUE;
+    entry->isDirectory = isDirectory;
+    entry->deleted = FALSE;
+    strncpy(entry->name, name, FileNameMaxLen); 
+    entry->name[FileNameMaxLen] = '\0';
+    entry->sector = newSector;
+    dirty->Mark(free);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -146,6 +394,11 @@ Directory::Add(char *name, int newSector)
 // 	Remove a file name from the directory.  Return TRUE if successful;
 //	return FALSE if the file isn't in the directory. 
 //
+//	If the slot after the name's has never been used, no probe
+//	sequence runs through the name's slot, so it is cleared rather
+//	than marked removed -- and so are the removed entries just
+//	before it, for the same reason.
+//
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
@@ -153,24 +406,71 @@ bool
 Directory::Remove(char *name)
 { 
     int i = FindIndex(name);
+    DirectoryEntry *next;
 
     if (i == -1)
 	return FALSE; 		// name not in directory
     table[i].inUse = FALSE;
+    table[i].deleted = TRUE;	// keep later probes going
+    dirty->Mark(i);
+
+    next = Entry((i + 1) % tableSize);
+    for (int n = 0; (n < MaxProbe) && !next->inUse && !next->deleted; n++) {
+	if (!table[i].deleted)
+	    break;
+	table[i].deleted = FALSE;	// nothing probes past it any more
+	dirty->Mark(i);
+	next = &table[i];
+	i = (i + tableSize - 1) % tableSize;
+	(void) Entry(i);
+    }
     return TRUE;	
 }
 
+//----------------------------------------------------------------------
+// Directory::IsEmpty
+// 	Return TRUE if no name in the directory is in use.  Reads in
+//	the whole table.
+//----------------------------------------------------------------------
+
+bool
+Directory::IsEmpty()
+{
+    for (int i = 0; i < tableSize; i++)
+	if (Entry(i)->inUse)
+	    return FALSE;
+    return TRUE;
+}
+
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory.  Sub-directories are
+//	shown with a trailing '/'.
+//
+//	"depth" -- how far to indent the names
+//	"recursive" -- should we also list each sub-directory?
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(int depth, bool recursive)
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+   for (int i = 0; i < tableSize; i++) {
+	DirectoryEntry *entry = Entry(i);
+
+	if (!entry->inUse)
+	    continue;
+	printf("%*s%s%s\n", 2 * depth, "", entry->name,
+				entry->isDirectory ? "/" : "");
+	if (recursive && entry->isDirectory) {
+	    OpenFile *subFile = new OpenFile(entry->sector);
+	    Directory *sub = new Directory(1);
+
+	    sub->FetchFrom(subFile);
+	    sub->List(depth + 1, TRUE);
+	    delete sub;
+	    delete subFile;
+	}
+   }
 }
 
 //----------------------------------------------------------------------
@@ -186,8 +486,9 @@ Directory::Print()
 
     printf("Directory contents:\n");
     for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
+	if (Entry(i)->inUse) {
+	    printf("Name: %s, Sector: %d%s\n", table[i].name, table[i].sector,
+				table[i].isDirectory ? ", Directory" : "");
 	    hdr->FetchFrom(table[i].sector);
 	    hdr->Print();
 	}
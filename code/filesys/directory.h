@@ -4,7 +4,14 @@
 //      A directory is a table of pairs: <file name, sector #>,
 //	giving the name of each file in the directory, and 
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  An entry may
+//	itself name a directory, giving a hierarchical name space.
+//
+//	The table is an open-addressed hash table: a name is stored
+//	at the slot its hash selects, or the first free slot after it,
+//	and never more than MaxProbe slots along, so that looking up a
+//	name touches at most MaxProbe entries no matter how big the
+//	directory is, or how many names have come and gone.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
@@ -18,9 +25,16 @@
 #define DIRECTORY_H
 
 #include "openfile.h"
+#include "bitmap.h"
+
+#define FileNameMaxLen 		59	// file names are <= 59 characters
+					// long; a path name may have any
+					// number of them, separated by '/'
 
-#define FileNameMaxLen 		9	// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define MaxProbe		8	// a name is never further than this
+					// from its home slot; if Add can't
+					// find a free slot that close, the
+					// table is grown
 
 // The following class defines a "directory entry", representing a file
 // in the directory.  Each entry gives the name of the file, and where
@@ -32,6 +46,9 @@
 class DirectoryEntry {
   public:
     bool inUse;				// Is this directory entry in use?
+    bool isDirectory;			// Does the entry name a directory?
+    bool deleted;			// Was the entry removed?  Lookups
+					// must probe past removed entries
     int sector;				// Location on disk to find the 
 					//   FileHeader for this file 
     char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
@@ -46,7 +63,9 @@ class DirectoryEntry {
 //
 // The constructor initializes a directory structure in memory; the
 // FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// from/to disk.  FetchFrom does not read the whole table: entries are
+// brought in from the file as a lookup probes them, and WriteBack
+// only writes the entries that were changed.
 
 class Directory {
   public:
@@ -55,27 +74,59 @@ class Directory {
     ~Directory();			// De-allocate the directory
 
     void FetchFrom(OpenFile *file);  	// Init directory contents from disk
+    bool Prepare(OpenFile *file);	// Get ready to WriteBack, before
+					// the operation that does it
     void WriteBack(OpenFile *file);	// Write modifications to 
 					// directory contents back to disk
 
     int Find(char *name);		// Find the sector number of the 
 					// FileHeader for file: "name"
+    int Find(char *name, bool *isDirectory);
+					// Same, also telling whether "name"
+					// is a sub-directory
 
-    bool Add(char *name, int newSector);  // Add a file name into the directory
+    bool Add(char *name, int newSector, bool isDirectory = FALSE);
+					// Add a file name into the directory
 
     bool Remove(char *name);		// Remove a file from the directory
 
-    void List();			// Print the names of all the files
-					//  in the directory
+    bool IsEmpty();			// Are there no names in use?
+
+    int Size() { return tableSize; }	// Number of entries in the table
+
+    void List(int depth = 0, bool recursive = FALSE);
+					// Print the names of all the files
+					//  in the directory, and optionally
+					//  in all its sub-directories
     void Print();			// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
 
+    static unsigned HashName(char *name); // Hash function used to place
+					// names in the table
+
   private:
     int tableSize;			// Number of directory entries
     DirectoryEntry *table;		// Table of pairs: 
 					// <file name, file header location> 
-
+    OpenFile *file;			// File the table was fetched from,
+					// NULL if it lives only in memory
+    Bitmap *loaded;			// Which entries of "table" have been
+					// read in from "file"
+    Bitmap *dirty;			// Which entries have been changed
+					// since they were read
+    bool rebuilt;			// Has the table been re-hashed, so
+					// that all of it must be written?
+
+    void Resize(int size);		// Re-allocate an empty table
+    void Rebuild(int size);		// Re-hash every name into a table
+					// of at least "size" entries,
+					// dropping removed entries
+    bool Place(DirectoryEntry *entries, int size, DirectoryEntry *entry);
+					// Put "entry" in "entries", within
+					// MaxProbe of its home slot
+    DirectoryEntry *Entry(int i);	// Return entry "i", reading it
+					// from "file" if necessary
     int FindIndex(char *name);		// Find the index into the directory 
 					//  table corresponding to "name"
 };
@@ -3,12 +3,13 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a table of
+//	pointers -- each entry in the table points to the disk sector
+//	containing that portion of the file data.  The first part of
+//	the table is in the file header itself, which is chosen to be
+//	just big enough to fit in one disk sector; the rest is kept in
+//	a singly indirect block, and in the blocks pointed to by a
+//	doubly indirect block.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -18,6 +19,9 @@
 //	     to point to the newly allocated data blocks
 //	   for a file already on disk, by reading the file header from disk
 //
+//	Either way, the file can later be extended, by allocating more
+//	data blocks (and indirect blocks, as needed) at its end.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -29,6 +33,171 @@
 #include "synchdisk.h"
 #include "main.h"
 
+// Bits in FileHeader::dirtyBlocks, one per in-memory indirect block
+#define IndirectDirty		0
+#define DoubleIndirectDirty	1
+#define DoubleBlockDirty(k)	(2 + (k))
+
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize the in-memory file header for an empty file.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    ASSERT(sizeof(int) * (NumDirect + 4) == SectorSize);
+    numBytes = 0;
+    numSectors = 0;
+    indirectSector = -1;
+    doubleIndirectSector = -1;
+    indirect = NULL;
+    doubleIndirect = NULL;
+    doubleBlocks = NULL;
+    dirtyBlocks = new Bitmap(NumIndirect + 2);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::~FileHeader
+// 	De-allocate the in-memory file header.  Any changes should
+//	already have been written back.
+//----------------------------------------------------------------------
+
+FileHeader::~FileHeader()
+{
+    FreeBlocks();
+    delete dirtyBlocks;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FreeBlocks
+// 	Throw away the in-memory copies of the indirect blocks.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FreeBlocks()
+{
+    delete [] indirect;
+    if (doubleBlocks != NULL) {
+	for (int k = 0; k < NumIndirect; k++)
+	    delete [] doubleBlocks[k];
+	delete [] doubleBlocks;
+    }
+    delete [] doubleIndirect;
+    indirect = NULL;
+    doubleIndirect = NULL;
+    doubleBlocks = NULL;
+    for (int k = 0; k < NumIndirect + 2; k++)
+	dirtyBlocks->Clear(k);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::LoadBlock
+// 	Return the in-memory copy of an indirect block, reading it in
+//	from "sector" if this is the first time it is needed.
+//----------------------------------------------------------------------
+
+int *
+FileHeader::LoadBlock(int **block, int sector)
+{
+    if (*block == NULL) {
+	ASSERT(sector >= 0);
+	*block = new int[NumIndirect];
+	kernel->synchDisk->ReadSector(sector, (char *)*block);
+    }
+    return *block;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::LoadDoubleIndirect
+// 	Make sure the doubly indirect block is in memory, along with
+//	space to keep the blocks it points to (which are read in
+//	individually by SectorSlot).
+//----------------------------------------------------------------------
+
+void
+FileHeader::LoadDoubleIndirect()
+{
+    LoadBlock(&doubleIndirect, doubleIndirectSector);
+    if (doubleBlocks == NULL) {
+	doubleBlocks = new int *[NumIndirect];
+	for (int k = 0; k < NumIndirect; k++)
+	    doubleBlocks[k] = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NewBlock
+// 	Allocate a sector for a new, empty indirect block, and return
+//	its number.  The caller has already checked there is space.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NewBlock(PersistentBitmap *freeMap, int **block)
+{
+    int sector = freeMap->FindAndSet();
+
+    ASSERT(sector >= 0);
+    *block = new int[NumIndirect];
+    for (int k = 0; k < NumIndirect; k++)
+	(*block)[k] = -1;
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::SectorSlot
+// 	Return where, in memory, the sector number of the "i"th data
+//	block of the file is kept, reading in indirect blocks as needed.
+//----------------------------------------------------------------------
+
+int *
+FileHeader::SectorSlot(int i)
+{
+    if (i < NumDirect)
+	return &dataSectors[i];
+    i -= NumDirect;
+    if (i < NumIndirect)
+	return &LoadBlock(&indirect, indirectSector)[i];
+    i -= NumIndirect;
+
+    LoadDoubleIndirect();
+    return &LoadBlock(&doubleBlocks[i / NumIndirect],
+			doubleIndirect[i / NumIndirect])[i % NumIndirect];
+}
+
+//----------------------------------------------------------------------
+// FileHeader::MarkDirty
+// 	Note that the sector number of data block "i" has changed, so
+//	the indirect block holding it must be written back.
+//----------------------------------------------------------------------
+
+void
+FileHeader::MarkDirty(int i)
+{
+    if (i < NumDirect)
+	return;				// it's in the header itself
+    i -= NumDirect;
+    if (i < NumIndirect)
+	dirtyBlocks->Mark(IndirectDirty);
+    else
+	dirtyBlocks->Mark(DoubleBlockDirty((i - NumIndirect) / NumIndirect));
+}
+
+//----------------------------------------------------------------------
+// FileHeader::IndexSectors
+// 	Return the number of indirect blocks (singly and doubly
+//	indirect) that a file of "sectors" data blocks needs.
+//----------------------------------------------------------------------
+
+int
+FileHeader::IndexSectors(int sectors)
+{
+    if (sectors <= NumDirect)
+	return 0;
+    if (sectors <= NumDirect + NumIndirect)
+	return 1;
+    return 2 + divRoundUp(sectors - NumDirect - NumIndirect, NumIndirect);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
@@ -37,29 +206,91 @@
 //	the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the initial size of the file, in bytes
 //----------------------------------------------------------------------
 
 bool
 FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
-	return FALSE;		// not enough space
+    FreeBlocks();
+    numBytes = 0;
+    numSectors = 0;
+    indirectSector = -1;
+    doubleIndirectSector = -1;
+    return Extend(freeMap, fileSize);
+}
 
-    for (int i = 0; i < numSectors; i++) {
-	dataSectors[i] = freeMap->FindAndSet();
+//----------------------------------------------------------------------
+// FileHeader::Extend
+// 	Grow the file to "newSize" bytes, allocating data blocks (and
+//	any indirect blocks needed to point to them) out of the map of
+//	free disk blocks.  Either all of the blocks are allocated, or,
+//	if there are not enough free blocks or the file would be bigger
+//	than MaxFileSize, none are and we return FALSE.
+//
+//	The new blocks are not cleared; the caller must not let anyone
+//	read data beyond the old end of the file that it hasn't written.
+//	The changes are only in memory until WriteBack is called.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"newSize" is the new size of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Extend(PersistentBitmap *freeMap, int newSize)
+{
+    int newSectors = divRoundUp(newSize, SectorSize);
+    int needed, run, i, j;
+
+    if (newSize <= numBytes)
+	return TRUE;			// nothing to do
+    if (newSectors > MaxFileSectors)
+	return FALSE;			// file too big
+    needed = (newSectors - numSectors)
+		+ IndexSectors(newSectors) - IndexSectors(numSectors);
+    if (freeMap->NumClear() < needed)
+	return FALSE;			// not enough space
+
+    // try to keep the new data blocks together on disk; if there is
+    // no run of free sectors long enough, take them one at a time
+    run = -1;
+    if (newSectors > numSectors)
+	run = freeMap->FindAndSetRun(newSectors - numSectors);
+    for (i = numSectors; i < newSectors; i++) {
+	if (i == NumDirect) {
+	    indirectSector = NewBlock(freeMap, &indirect);
+	    dirtyBlocks->Mark(IndirectDirty);
+	} else if (i >= NumDirect + NumIndirect) {
+	    j = i - NumDirect - NumIndirect;
+	    if (j == 0) {
+		doubleIndirectSector = NewBlock(freeMap, &doubleIndirect);
+		dirtyBlocks->Mark(DoubleIndirectDirty);
+	    }
+	    if ((j % NumIndirect) == 0) {
+		LoadDoubleIndirect();
+		doubleIndirect[j / NumIndirect] = NewBlock(freeMap,
+					&doubleBlocks[j / NumIndirect]);
+		dirtyBlocks->Mark(DoubleIndirectDirty);
+	    }
+	}
+	if (run != -1)
+	    *SectorSlot(i) = run + (i - numSectors);
+	else
+	    *SectorSlot(i) = freeMap->FindAndSet();
 	// since we checked that there was enough free space,
 	// we expect this to succeed
-	ASSERT(dataSectors[i] >= 0);
+	ASSERT(*SectorSlot(i) >= 0);
+	MarkDirty(i);
     }
+    numSectors = newSectors;
+    numBytes = newSize;
     return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and the indirect blocks that point to them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -67,15 +298,64 @@ FileHeader::Allocate(PersistentBitmap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(PersistentBitmap *freeMap)
 {
+    int sector;
+
     for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+	sector = *SectorSlot(i);
+	ASSERT(freeMap->Test(sector));  // ought to be marked!
+	freeMap->Clear(sector);
+    }
+    if (indirectSector != -1)
+	freeMap->Clear(indirectSector);
+    if (doubleIndirectSector != -1) {
+	for (int k = 0; k < NumIndirect; k++)
+	    if (doubleIndirect[k] != -1)
+		freeMap->Clear(doubleIndirect[k]);
+	freeMap->Clear(doubleIndirectSector);
     }
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Replace
+// 	Make this header describe the blocks "other" describes -- a new
+//	copy of the file's contents, written where nothing pointed to
+//	them (see FileSystem::WriteAside) -- taking over its in-memory
+//	indirect blocks, and which of them must be written back.  Our
+//	own blocks have already been de-allocated.  "other" is left
+//	describing an empty file.
+//----------------------------------------------------------------------
+
+void
+FileHeader::Replace(FileHeader *other)
+{
+    FreeBlocks();
+    numBytes = other->numBytes;
+    numSectors = other->numSectors;
+    for (int i = 0; i < NumDirect; i++)
+	dataSectors[i] = other->dataSectors[i];
+    indirectSector = other->indirectSector;
+    doubleIndirectSector = other->doubleIndirectSector;
+    indirect = other->indirect;
+    doubleIndirect = other->doubleIndirect;
+    doubleBlocks = other->doubleBlocks;
+    for (int k = 0; k < NumIndirect + 2; k++)
+	if (other->dirtyBlocks->Test(k))
+	    dirtyBlocks->Mark(k);
+
+    other->indirect = NULL;
+    other->doubleIndirect = NULL;
+    other->doubleBlocks = NULL;
+    other->FreeBlocks();
+    other->numBytes = 0;
+    other->numSectors = 0;
+    other->indirectSector = -1;
+    other->doubleIndirectSector = -1;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk.  The indirect blocks
+//	are read in later, if they are needed.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -83,12 +363,16 @@ FileHeader::Deallocate(PersistentBitmap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
+    FreeBlocks();
     kernel->synchDisk->ReadSector(sector, (char *)this);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk.
+//	Changed indirect blocks are written first, so that the header
+//	on disk never points to a block that hasn't been initialized.
+//	Everything goes through the log (see SynchDisk::WriteLogged).
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -96,7 +380,42 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    kernel->synchDisk->WriteSector(sector, (char *)this); 
+    (void) WriteBackBlocks(NumIndirect);
+    if (dirtyBlocks->Test(IndirectDirty))
+	kernel->synchDisk->WriteLogged(indirectSector, (char *)indirect);
+    if (dirtyBlocks->Test(DoubleIndirectDirty))
+	kernel->synchDisk->WriteLogged(doubleIndirectSector,
+					(char *)doubleIndirect);
+    dirtyBlocks->Clear(IndirectDirty);
+    dirtyBlocks->Clear(DoubleIndirectDirty);
+
+    kernel->synchDisk->WriteLogged(sector, (char *)this); 
+}
+
+//----------------------------------------------------------------------
+// FileHeader::WriteBackBlocks
+// 	Write back up to "count" of the changed blocks that the doubly
+//	indirect block points to, and return how many were written.
+//
+//	Nothing on disk leads to the new sector numbers in these blocks
+//	until the header has been written back, so they may go first,
+//	a few at a time; a file that has grown by a lot may have more
+//	of them than fit in the log at once (see FileSystem::WriteBackBlocks).
+//----------------------------------------------------------------------
+
+int
+FileHeader::WriteBackBlocks(int count)
+{
+    int written = 0;
+
+    for (int k = 0; (k < NumIndirect) && (written < count); k++)
+	if (dirtyBlocks->Test(DoubleBlockDirty(k))) {
+	    kernel->synchDisk->WriteLogged(doubleIndirect[k],
+					(char *)doubleBlocks[k]);
+	    dirtyBlocks->Clear(DoubleBlockDirty(k));
+	    written++;
+	}
+    return written;
 }
 
 //----------------------------------------------------------------------
@@ -112,7 +431,7 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    return *SectorSlot(offset / SectorSize);
 }
 
 //----------------------------------------------------------------------
@@ -140,10 +459,14 @@ FileHeader::Print()
 
     printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
     for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+	printf("%d ", *SectorSlot(i));
+    if (indirectSector != -1)
+	printf("\nIndirect block: %d", indirectSector);
+    if (doubleIndirectSector != -1)
+	printf("\nDoubly indirect block: %d", doubleIndirectSector);
     printf("\nFile contents:\n");
     for (i = k = 0; i < numSectors; i++) {
-	kernel->synchDisk->ReadSector(dataSectors[i], data);
+	kernel->synchDisk->ReadSector(*SectorSlot(i), data);
         for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
@@ -17,35 +17,53 @@
 #include "disk.h"
 #include "pbitmap.h"
 
-#define NumDirect 	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize 	(NumDirect * SectorSize)
+// Number of sector numbers that fit in an indirect block, and in the
+// file header itself next to the other on-disk fields
+#define NumIndirect	((int) (SectorSize / sizeof(int)))
+#define NumDirect 	((int) ((SectorSize - 4 * sizeof(int)) / sizeof(int)))
+#define MaxFileSectors	(NumDirect + NumIndirect + NumIndirect * NumIndirect)
+#define MaxFileSize 	(MaxFileSectors * SectorSize)
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
+// The file header is organized as a table of pointers to data blocks,
+// as in UNIX: the first NumDirect point straight at data blocks, the
+// next NumIndirect are kept in a singly indirect block, and the rest
+// are found through a doubly indirect block.
 //
 // The file header data structure can be stored in memory or on disk.
 // When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// that we assume the size of the on-disk part of this data structure
+// to be the same as one disk sector.  The indirect blocks are read in
+// when they are first needed, and kept in memory with the header.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// A file header can be initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.  A file can be
+// extended later by allocating more blocks.
 
 class FileHeader {
   public:
+    FileHeader();			// Initialize an empty file header
+    ~FileHeader();			// De-allocate the in-memory header
+
     bool Allocate(PersistentBitmap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
+    bool Extend(PersistentBitmap *bitMap, int newSize);
+						// Grow the file to "newSize"
+						//  bytes, allocating any
+						//  blocks that are needed
     void Deallocate(PersistentBitmap *bitMap);  // De-allocate this file's 
-						//  data blocks
+						//  data and indirect blocks
+    void Replace(FileHeader *other);	// Take over the blocks of "other",
+					//  once our own are de-allocated
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
-					//  back to disk
+					//  and indirect blocks back to disk
+    int WriteBackBlocks(int count);	// Write back some of the changed
+					//  blocks under the doubly indirect
+					//  block, ahead of the header
 
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
@@ -57,10 +75,36 @@ class FileHeader {
     void Print();			// Print the contents of the file.
 
   private:
+    // The following fields are stored on disk, in exactly one sector.
     int numBytes;			// Number of bytes in the file
     int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
-					// block in the file
+    int dataSectors[NumDirect];		// Disk sector numbers for the first
+					// NumDirect data blocks in the file
+    int indirectSector;			// Singly indirect block, or -1
+    int doubleIndirectSector;		// Doubly indirect block, or -1
+
+    // The following fields are only kept in memory.
+    int *indirect;			// Contents of the indirect block
+    int *doubleIndirect;		// Contents of the doubly indirect
+					// block
+    int **doubleBlocks;			// Contents of the indirect blocks
+					// it points to
+    Bitmap *dirtyBlocks;		// Which indirect blocks must be
+					// written back (see MarkDirty)
+
+    int *SectorSlot(int i);		// Where the sector number of data
+					// block "i" is kept in memory
+    int *LoadBlock(int **block, int sector);
+					// Read in an indirect block
+    void LoadDoubleIndirect();		// Read in the doubly indirect block
+    int NewBlock(PersistentBitmap *freeMap, int **block);
+					// Allocate an empty indirect block
+    void MarkDirty(int i);		// Note that the block holding the
+					// sector number of "i" has changed
+    void FreeBlocks();			// Forget the in-memory indirect
+					// blocks
+    static int IndexSectors(int sectors); // Number of indirect blocks
+					// needed for a file of "sectors"
 };
 
 #endif // FILEHDR_H
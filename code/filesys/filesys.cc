@@ -7,11 +7,17 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in the directory that contains it
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers,
+//	     starting at the root directory
+//
+//	A file is named by a path of directory names, separated by
+//	'/', ending with the name of the file itself.  Each directory
+//	along the path is a file whose contents are a Directory.
+//	A dentry cache remembers recently resolved path components.
 //
 //      Both the bitmap and the directory are represented as normal
 //	files.  Their file headers are located in specific sectors
@@ -28,16 +34,21 @@
 //	modified part of the directory and/or bitmap, we simply discard
 //	the changed version, without writing it back to disk.
 //
+//	Several threads may use the file system at once.  Each directory,
+//	like each file, has a reader-writer lock (see OpenFile): looking
+//	a name up holds the directory's lock for reading, and adding or
+//	removing a name holds it for writing.  A lock on the file system
+//	as a whole guards the bitmap of free sectors.
+//
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
-//	   there is no attempt to make the system robust to failures
-//	    (if Nachos exits in the middle of an operation that modifies
-//	    the file system, it may corrupt the disk)
+//	   files cannot be bigger than about 135KB in size
+//
+//	Operations that change the directories, the bitmap or a file
+//	header write their changes through a log (see journal.h), so
+//	that if Nachos exits in the middle of one, it is either finished
+//	or undone when the disk is next mounted.  The data in files is
+//	not logged.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -51,6 +62,12 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "dcache.h"
+#include "journal.h"
+#include "filetable.h"
+#include "synch.h"
+#include "synchdisk.h"
+#include "main.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known
@@ -58,13 +75,35 @@
 #define FreeMapSector 0
 #define DirectorySector 1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number
-// of files that can be loaded onto the disk.
-#define FreeMapFileSize (NumSectors / BitsInByte)
-#define NumDirEntries 10
+// The log of file system operations starts right after them; how
+// many sectors it takes depends on the size of the disk (see
+// Journal::Journal).
+#define LogSector 2
+
+// The file system lives on the kernel's first disk, whatever its size
+#define NumDiskSectors (kernel->synchDisk->NumSectors())
+
+// Initial file sizes for the bitmap and directory; directories grow
+// as files are added to them.  The bitmap has one bit per sector,
+// rounded up to whole words.
+#define FreeMapFileSize (divRoundUp(NumDiskSectors, BitsInWord) * sizeof(unsigned int))
+#define NumDirEntries 8
 #define DirectoryFileSize (sizeof(DirectoryEntry) * NumDirEntries)
 
+// The most sectors an operation writes through the log: the header of
+// a new file, with both kinds of indirect block; for a new directory,
+// its empty table; the entry in the parent directory, which may
+// straddle two sectors -- or, if the parent was re-hashed, its header
+// and indirect blocks (see FileSystem::Switch); and the bitmap.  The
+// blocks under a doubly indirect block are written ahead of time (see
+// FileSystem::WriteBackBlocks).  Removing a name may clear up to
+// MaxProbe removed entries besides, which fit in the same room.
+#define OpLogSectors ((int) (3 + divRoundUp(DirectoryFileSize, SectorSize) + 3 \
+                             + divRoundUp(FreeMapFileSize, SectorSize)))
+
+// Number of resolved path components remembered by the dentry cache
+#define DentryCacheSize 64
+
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format = TRUE, the disk has
@@ -72,8 +111,9 @@
 //	an empty directory, and a bitmap of free sectors (with almost but
 //	not all of the sectors marked as free).
 //
-//	If format = FALSE, we just have to open the files
-//	representing the bitmap and the directory.
+//	If format = FALSE, we just have to finish any operation left in
+//	the log, and open the files representing the bitmap and the
+//	directory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
@@ -81,9 +121,12 @@
 FileSystem::FileSystem(bool format)
 {
   DEBUG(dbgFile, "Initializing the file system.");
+  dentryCache = new DentryCache(DentryCacheSize);
+  journal = new Journal(LogSector, OpLogSectors);
+  freeMapLock = new Lock("free map");
   if (format)
   {
-    PersistentBitmap *freeMap = new PersistentBitmap(NumSectors);
+    freeMap = new PersistentBitmap(NumDiskSectors);
     Directory *directory = new Directory(NumDirEntries);
     FileHeader *mapHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
@@ -94,6 +137,9 @@ FileSystem::FileSystem(bool format)
     // (make sure no one else grabs these!)
     freeMap->Mark(FreeMapSector);
     freeMap->Mark(DirectorySector);
+    for (int i = 0; i < journal->Size(); i++)
+      freeMap->Mark(LogSector + i);
+    journal->Format();
 
     // Second, allocate space for the data blocks containing the contents
     // of the directory and bitmap files.  There better be enough space!
@@ -132,179 +178,641 @@ FileSystem::FileSystem(bool format)
       freeMap->Print();
       directory->Print();
     }
-    delete freeMap;
     delete directory;
     delete mapHdr;
     delete dirHdr;
+    kernel->synchDisk->SetJournal(journal);
   }
   else
   {
-    // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // if we are not formatting the disk, replay the log, and open the files
+    // representing the bitmap and directory; these are left open while
+    // Nachos is running
+    if (journal->Recover())
+      kernel->synchDisk->SetJournal(journal);
+    else
+      DEBUG(dbgFile, "No log on disk; operations will not be logged.");
     freeMapFile = new OpenFile(FreeMapSector);
     directoryFile = new OpenFile(DirectorySector);
+    freeMap = new PersistentBitmap(freeMapFile, NumDiskSectors);
   }
 }
 
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Close the bitmap and root directory files, and throw away the
+//	in-memory bitmap, the dentry cache and the log.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+  kernel->synchDisk->SetJournal(NULL);
+  delete journal;
+  delete freeMap;
+  delete freeMapFile;
+  delete directoryFile;
+  delete dentryCache;
+  delete freeMapLock;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Grow an open file to "newLength" bytes, allocating space for it
+//	out of the free map.  Return FALSE, leaving the file as it was,
+//	if there isn't enough room on the disk.
+//
+//	The bitmap and the file header (with any new indirect blocks)
+//	are written back as one logged operation.  The bitmap is let go
+//	of before the operation begins, since Begin may have to wait for
+//	other operations, which may need the bitmap.  (Another operation
+//	may then commit the bitmap first; if we crash before our own
+//	commit, the new blocks stay marked in use, though nothing on disk
+//	points to them.)
+//
+//	"hdr" -- the in-memory header of the file
+//	"hdrSector" -- where the header is stored on disk
+//	"newLength" -- the new size of the file, in bytes
+//----------------------------------------------------------------------
+
+bool FileSystem::Extend(FileHeader *hdr, int hdrSector, int newLength)
+{
+  bool success;
+
+  DEBUG(dbgFile, "Extending file at sector " << hdrSector << " to " << newLength);
+  freeMapLock->Acquire();
+  success = hdr->Extend(freeMap, newLength);
+  freeMapLock->Release();
+  if (!success)
+    return FALSE;
+  WriteBackBlocks(hdr);
+  journal->Begin();
+  freeMapLock->Acquire();
+  freeMap->WriteBack(freeMapFile);
+  freeMapLock->Release();
+  hdr->WriteBack(hdrSector);
+  journal->End();
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteBackBlocks
+// 	Write back the changed blocks under a file's doubly indirect
+//	block, as many at a time as an operation may write,
+//	each lot in an operation of its own.  A file that has just been
+//	given a lot of space may have more of them than fit in the log;
+//	they must go first, before the operation that writes the header
+//	(see FileHeader::WriteBackBlocks).
+//
+//	"hdr" -- the in-memory header of the file
+//----------------------------------------------------------------------
+
+void FileSystem::WriteBackBlocks(FileHeader *hdr)
+{
+  int count = OpLogSectors;
+  int written;
+
+  if (hdr->FileLength() <= (NumDirect + NumIndirect) * SectorSize)
+    return; // no doubly indirect block
+  do
+  {
+    journal->Begin();
+    written = hdr->WriteBackBlocks(count);
+    journal->End();
+  } while (written == count);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::WriteAside
+// 	Allocate blocks for a new copy of a file's contents, and write
+//	"from" to them, straight to disk: nothing points to the blocks
+//	until FileSystem::Switch is done, so a crash before then only
+//	loses them.  The blocks under a doubly indirect block are written
+//	the same way as for any file that grows (see WriteBackBlocks).
+//	Return the header describing the blocks, or NULL if the disk is
+//	full.
+//
+//	"from" -- the new contents of the file
+//	"numBytes" -- how long they are
+//----------------------------------------------------------------------
+
+FileHeader *
+FileSystem::WriteAside(char *from, int numBytes)
+{
+  FileHeader *aside = new FileHeader;
+  int whole = numBytes / SectorSize;
+  int i, n, first;
+  char *buf;
+
+  freeMapLock->Acquire();
+  if (!aside->Allocate(freeMap, numBytes))
+  {
+    freeMapLock->Release();
+    delete aside;
+    return NULL; // no space on disk
+  }
+  freeMapLock->Release();
+  DEBUG(dbgFile, "Writing " << numBytes << " bytes aside");
+
+  // whole sectors, in runs that are consecutive on disk
+  for (i = 0; i < whole; i += n)
+  {
+    first = aside->ByteToSector(i * SectorSize);
+    for (n = 1; (i + n < whole) &&
+                (aside->ByteToSector((i + n) * SectorSize) == first + n);
+         n++)
+      ;
+    kernel->synchDisk->WriteSectors(first, n, &from[i * SectorSize]);
+  }
+  if (whole * SectorSize < numBytes)
+  { // the last sector is only partly used; clear the rest
+    buf = kernel->currentThread->ScratchSector();
+    bzero(buf, SectorSize);
+    bcopy(&from[whole * SectorSize], buf, numBytes - whole * SectorSize);
+    kernel->synchDisk->WriteSector(aside->ByteToSector(whole * SectorSize),
+                                   buf);
+  }
+  WriteBackBlocks(aside);
+  return aside;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Switch
+// 	Give a file the blocks written by WriteAside, and free its old
+//	ones, as one logged operation -- or as part of the caller's.
+//	Only the file's header and its indirect blocks, and the changed
+//	parts of the bitmap, are logged.
+//
+//	"hdr" -- the in-memory header of the file
+//	"hdrSector" -- where the header is stored on disk
+//	"aside" -- the header returned by WriteAside; it is deleted
+//----------------------------------------------------------------------
+
+void FileSystem::Switch(FileHeader *hdr, int hdrSector, FileHeader *aside)
+{
+  DEBUG(dbgFile, "Switching file at sector " << hdrSector << " to new blocks");
+  journal->Begin();
+  freeMapLock->Acquire();
+  hdr->Deallocate(freeMap); // the old contents
+  hdr->Replace(aside);
+  freeMap->WriteBack(freeMapFile);
+  freeMapLock->Release();
+  hdr->WriteBack(hdrSector);
+  journal->End();
+  delete aside;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Reclaim
+// 	Give back the header sector and data blocks of a file that has
+//	been removed from its directory.  Called by Remove, or, if the
+//	file was open at the time, by OpenFileTable::Close once it is
+//	closed for the last time.
+//
+//	"hdr" -- the in-memory header of the file
+//	"hdrSector" -- where the header is stored on disk
+//----------------------------------------------------------------------
+
+void FileSystem::Reclaim(FileHeader *hdr, int hdrSector)
+{
+  DEBUG(dbgFile, "Freeing file at sector " << hdrSector);
+  journal->Begin();
+  freeMapLock->Acquire();
+  hdr->Deallocate(freeMap); // remove data blocks
+  freeMap->Clear(hdrSector); // remove header block
+  freeMap->WriteBack(freeMapFile); // flush to disk
+  freeMapLock->Release();
+  journal->End();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::FindParent
+// 	Resolve every component of a path name except the last one,
+//	and return the sector of the header of the directory that should
+//	contain the last one.  The last component is copied to "leafName";
+//	it is left empty if the path names the root directory itself.
+//
+//	Return -1 if some component along the way doesn't exist, isn't
+//	a directory, or is longer than FileNameMaxLen.
+//
+//	"name" -- the path name, such as "/dir/sub/file"; the leading
+//		'/' is optional, and repeated '/'s are ignored
+//	"leafName" -- space for at least FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int FileSystem::FindParent(char *name, char *leafName)
+{
+  int dirSector = DirectorySector;
+  char component[FileNameMaxLen + 1];
+  bool isDirectory;
+  int len;
+
+  leafName[0] = '\0';
+  while (*name == '/')
+    name++;
+  while (*name != '\0')
+  {
+    for (len = 0; name[len] != '\0' && name[len] != '/'; len++)
+      ;
+    if (len > FileNameMaxLen)
+      return -1; // name too long to be in any directory
+    strncpy(component, name, len);
+    component[len] = '\0';
+    name += len;
+    while (*name == '/')
+      name++;
+
+    if (*name == '\0')
+    { // last component; its directory is the one we are in
+      strcpy(leafName, component);
+      break;
+    }
+    dirSector = Lookup(dirSector, component, &isDirectory);
+    if (dirSector == -1 || !isDirectory)
+      return -1;
+  }
+  return dirSector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Lookup
+// 	Look up a single name in a directory, and return the sector
+//	of its file header, or -1 if it isn't there.  Consult the dentry
+//	cache first, and remember what we find on disk.  The directory
+//	is locked for reading while we look.
+//
+//	"dirSector" -- the sector of the directory's file header
+//	"name" -- the name to look for
+//	"isDirectory" -- set to whether "name" is a directory
+//----------------------------------------------------------------------
+
+int FileSystem::Lookup(int dirSector, char *name, bool *isDirectory)
+{
+  OpenFile *dirFile;
+  Directory *directory;
+  int sector;
+
+  if (dentryCache->Find(dirSector, name, &sector, isDirectory))
+    return sector;
+
+  dirFile = OpenDirectory(dirSector);
+  dirFile->GetLock()->AcquireRead();
+  directory = new Directory(NumDirEntries);
+  directory->FetchFrom(dirFile);
+  sector = directory->Find(name, isDirectory);
+  if (sector != -1)
+    dentryCache->Insert(dirSector, name, sector, *isDirectory);
+  delete directory;
+  dirFile->GetLock()->ReleaseRead();
+  CloseDirectory(dirFile);
+  return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory/CloseDirectory
+// 	Open and close the file holding a directory.  The root directory
+//	is always open, so we hand out our copy of it.
+//----------------------------------------------------------------------
+
+OpenFile *
+FileSystem::OpenDirectory(int sector)
+{
+  if (sector == DirectorySector)
+    return directoryFile;
+  return new OpenFile(sector);
+}
+
+void FileSystem::CloseDirectory(OpenFile *dirFile)
+{
+  if (dirFile != directoryFile)
+    delete dirFile;
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	Files grow as they are written; "initialSize" lets the caller
+//	allocate the space up front.
 //
 //	The steps to create a file are:
+//	  Find the directory that is to contain the file
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
-//	  Add the name to the directory
+//	  Add the name to the directory, growing it if it is full
 //	  Store the new file header on disk
 //	  Flush the changes to the bitmap and the directory back to disk
 //
 //	Return TRUE if everything goes ok, otherwise, return FALSE.
 //
 // 	Create fails if:
+//		some directory along the path doesn't exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
 //	 	no free space for data blocks for the file
+//		no free space for a directory that had to grow
 //
 // 	Note that this implementation assumes there is no concurrent access
 //	to the file system!
 //
-//	"name" -- name of file to be created
+//	"name" -- path name of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool FileSystem::Create(char *name, int initialSize)
+{
+  DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+  return CreateEntry(name, initialSize, FALSE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Mkdir
+// 	Create an empty directory (similar to UNIX mkdir).  A directory
+//	is created just like a file, except that it is marked as a
+//	directory in its parent, and its contents are an empty Directory.
+//
+//	"name" -- path name of the directory to be created
+//----------------------------------------------------------------------
+
+bool FileSystem::Mkdir(char *name)
+{
+  DEBUG(dbgFile, "Creating directory " << name);
+  return CreateEntry(name, DirectoryFileSize, TRUE);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CreateEntry
+// 	Do the work of Create and Mkdir.
+//
+//	"name" -- path name of the file to be created
+//	"initialSize" -- size of file to be created
+//	"isDirectory" -- should the new file be an empty directory?
+//----------------------------------------------------------------------
+
+bool FileSystem::CreateEntry(char *name, int initialSize, bool isDirectory)
 {
   Directory *directory;
-  PersistentBitmap *freeMap;
   FileHeader *hdr;
-  int sector;
+  OpenFile *dirFile;
+  char leafName[FileNameMaxLen + 1];
+  int dirSector, sector;
   bool success;
 
-  DEBUG(dbgFile, "Creating file " << name << " size " << initialSize);
+  dirSector = FindParent(name, leafName);
+  if (dirSector == -1 || leafName[0] == '\0')
+    return FALSE; // no such directory, or name is the root
 
+  dirFile = OpenDirectory(dirSector);
+  dirFile->GetLock()->AcquireWrite();
   directory = new Directory(NumDirEntries);
-  directory->FetchFrom(directoryFile);
+  directory->FetchFrom(dirFile);
 
-  if (directory->Find(name) != -1)
+  if (directory->Find(leafName) != -1)
     success = FALSE; // file is already in directory
   else
   {
-    freeMap = new PersistentBitmap(freeMapFile, NumSectors);
+    freeMapLock->Acquire();
     sector = freeMap->FindAndSet(); // find a sector to hold the file header
     if (sector == -1)
+    {
       success = FALSE; // no free block for file header
-    else if (!directory->Add(name, sector))
-      success = FALSE; // no space in directory
+      freeMapLock->Release();
+    }
     else
     {
       hdr = new FileHeader;
       if (!hdr->Allocate(freeMap, initialSize))
-        success = FALSE; // no space on disk for data
+      {
+        success = FALSE;       // no space on disk for data
+        freeMap->Clear(sector); // give back the header block
+        freeMapLock->Release();
+      }
       else
       {
-        success = TRUE;
-        // everthing worked, flush all changes back to disk
-        hdr->WriteBack(sector);
-        directory->WriteBack(directoryFile);
-        freeMap->WriteBack(freeMapFile);
+        // let go of the bitmap while writing the directory, which
+        // may need to grow (see FileSystem::WriteAside)
+        freeMapLock->Release();
+        WriteBackBlocks(hdr);
+        success = directory->Add(leafName, sector, isDirectory);
+        ASSERT(success);       // we checked the name isn't there
+        // a directory that was re-hashed is written out whole, ahead
+        // of the operation
+        if (!directory->Prepare(dirFile))
+        {
+          success = FALSE; // no space on disk for the directory
+          freeMapLock->Acquire();
+          hdr->Deallocate(freeMap);
+          freeMap->Clear(sector);
+          freeMapLock->Release();
+        }
+        else
+        {
+          // everthing worked, flush all changes back to disk
+          journal->Begin();
+          hdr->WriteBack(sector);
+          if (isDirectory)
+          {
+            OpenFile *newDirFile = new OpenFile(sector);
+            Directory *newDirectory = new Directory(NumDirEntries);
+
+            newDirectory->WriteBack(newDirFile);
+            delete newDirectory;
+            delete newDirFile;
+          }
+          directory->WriteBack(dirFile);
+          freeMapLock->Acquire();
+          freeMap->WriteBack(freeMapFile);
+          freeMapLock->Release();
+          journal->End();
+          dentryCache->Insert(dirSector, leafName, sector, isDirectory);
+        }
       }
       delete hdr;
     }
-    delete freeMap;
   }
   delete directory;
+  dirFile->GetLock()->ReleaseWrite();
+  CloseDirectory(dirFile);
   return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::BeginBatch
+// FileSystem::EndBatch
+// 	Bracket a series of operations -- creating many files at once,
+//	say -- so that their changes are committed to the log together,
+//	instead of one operation at a time.  The directory and bitmap
+//	sectors that every operation changes are then written out only
+//	once per commit.  The log is still committed whenever it hasn't
+//	room for another operation, and at EndBatch; each operation is
+//	protected from crashes as usual (see Journal::HoldCommits).
+//----------------------------------------------------------------------
+
+void FileSystem::BeginBatch()
+{
+  journal->HoldCommits();
+}
+
+void FileSystem::EndBatch()
+{
+  journal->ReleaseCommits();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
 // 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory
+//	  Find the location of the file's header, using the directories
+//	    along its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path name of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(char *name)
 {
-  Directory *directory = new Directory(NumDirEntries);
   OpenFile *openFile = NULL;
+  char leafName[FileNameMaxLen + 1];
+  bool isDirectory;
   int sector;
 
   DEBUG(dbgFile, "Opening file" << name);
-  directory->FetchFrom(directoryFile);
-  sector = directory->Find(name);
+  sector = FindParent(name, leafName);
+  if (sector != -1 && leafName[0] != '\0')
+    sector = Lookup(sector, leafName, &isDirectory);
   if (sector >= 0)
     openFile = new OpenFile(sector); // name was found in directory
-  delete directory;
   return openFile; // return NULL if not found
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from its directory
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
 //	    Write changes to directory, bitmap back to disk
 //
+//	A directory can only be removed once it is empty.
+//
+//	If the file is open, it disappears from its directory right
+//	away, but its space is only freed when it is last closed.
+//
 //	Return TRUE if the file was deleted, FALSE if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory that isn't empty.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path name of the file to be removed
 //----------------------------------------------------------------------
 
 bool FileSystem::Remove(char *name)
 {
   Directory *directory;
-  PersistentBitmap *freeMap;
   FileHeader *fileHdr;
-  int sector;
+  OpenFile *dirFile;
+  char leafName[FileNameMaxLen + 1];
+  int dirSector, sector;
+  bool isDirectory;
+
+  dirSector = FindParent(name, leafName);
+  if (dirSector == -1 || leafName[0] == '\0')
+    return FALSE; // no such directory, or name is the root
 
+  dirFile = OpenDirectory(dirSector);
+  dirFile->GetLock()->AcquireWrite();
   directory = new Directory(NumDirEntries);
-  directory->FetchFrom(directoryFile);
-  sector = directory->Find(name);
+  directory->FetchFrom(dirFile);
+  sector = directory->Find(leafName, &isDirectory);
   if (sector == -1)
   {
     delete directory;
+    dirFile->GetLock()->ReleaseWrite();
+    CloseDirectory(dirFile);
     return FALSE; // file not found
   }
-  fileHdr = new FileHeader;
-  fileHdr->FetchFrom(sector);
-
-  freeMap = new PersistentBitmap(freeMapFile, NumSectors);
-
-  fileHdr->Deallocate(freeMap); // remove data blocks
-  freeMap->Clear(sector);       // remove header block
-  directory->Remove(name);
-
-  freeMap->WriteBack(freeMapFile);     // flush to disk
-  directory->WriteBack(directoryFile); // flush to disk
-  delete fileHdr;
+  if (isDirectory)
+  {
+    OpenFile *subFile = new OpenFile(sector);
+    Directory *sub = new Directory(NumDirEntries);
+    bool empty;
+
+    subFile->GetLock()->AcquireRead();
+    sub->FetchFrom(subFile);
+    empty = sub->IsEmpty();
+    subFile->GetLock()->ReleaseRead();
+    delete sub;
+    delete subFile;
+    if (!empty)
+    {
+      delete directory;
+      dirFile->GetLock()->ReleaseWrite();
+      CloseDirectory(dirFile);
+      return FALSE; // directory still has files in it
+    }
+  }
+  directory->Remove(leafName);
+  dentryCache->Remove(dirSector, leafName);
+
+  journal->Begin();
+  directory->WriteBack(dirFile); // flush to disk
+  if (!kernel->openFileTable->MarkRemoved(sector))
+  { // not open, so free it now, as part of the same operation
+    fileHdr = new FileHeader;
+    fileHdr->FetchFrom(sector);
+    Reclaim(fileHdr, sector);
+    delete fileHdr;
+  }
+  journal->End();
   delete directory;
-  delete freeMap;
+  dirFile->GetLock()->ReleaseWrite();
+  CloseDirectory(dirFile);
   return TRUE;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the root directory, or in the directory
+//	"name".  If "recursive", also list the contents of every
+//	sub-directory, indented under its name.
 //----------------------------------------------------------------------
 
 void FileSystem::List()
 {
   Directory *directory = new Directory(NumDirEntries);
 
+  directoryFile->GetLock()->AcquireRead();
   directory->FetchFrom(directoryFile);
   directory->List();
+  directoryFile->GetLock()->ReleaseRead();
   delete directory;
 }
 
+void FileSystem::List(char *name, bool recursive)
+{
+  Directory *directory;
+  OpenFile *dirFile;
+  char leafName[FileNameMaxLen + 1];
+  bool isDirectory = TRUE;
+  int sector;
+
+  sector = FindParent(name, leafName);
+  if (sector != -1 && leafName[0] != '\0')
+    sector = Lookup(sector, leafName, &isDirectory);
+  if (sector == -1 || !isDirectory)
+  {
+    printf("List: %s is not a directory\n", name);
+    return;
+  }
+
+  dirFile = OpenDirectory(sector);
+  dirFile->GetLock()->AcquireRead();
+  directory = new Directory(NumDirEntries);
+  directory->FetchFrom(dirFile);
+  directory->List(0, recursive);
+  delete directory;
+  dirFile->GetLock()->ReleaseRead();
+  CloseDirectory(dirFile);
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
@@ -319,7 +827,6 @@ void FileSystem::Print()
 {
   FileHeader *bitHdr = new FileHeader;
   FileHeader *dirHdr = new FileHeader;
-  PersistentBitmap *freeMap = new PersistentBitmap(freeMapFile, NumSectors);
   Directory *directory = new Directory(NumDirEntries);
 
   printf("Bit map file header:\n");
@@ -337,7 +844,6 @@ void FileSystem::Print()
 
   delete bitHdr;
   delete dirHdr;
-  delete freeMap;
   delete directory;
 }
 
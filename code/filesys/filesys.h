@@ -18,9 +18,10 @@
 //	file system (in a file named "DISK").
 //
 //	In the "real" implementation, there are two key data structures used
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.
+//	in the file system.  There is a "root" directory, listing
+//	the files at the top of the file system; as in UNIX, a directory
+//	may itself contain directories, and files are named by a path
+//	such as "/dir/sub/file".
 //	In addition, there is a bitmap for allocating
 //	disk sectors.  Both the root directory and the bitmap are themselves
 //	stored as files in the Nachos file system -- this causes an interesting
@@ -46,11 +47,7 @@ typedef int OpenFileId;
 class FileSystem
 {
 public:
-  FileSystem()
-  {
-    for (int i = 0; i < 20; i++)
-      OpenFileTable[i] = NULL;
-  }
+  FileSystem() {}
 
   bool Create(char *name)
   {
@@ -61,7 +58,8 @@ public:
     Close(fileDescriptor);
     return TRUE;
   }
-  //The OpenFile function is used for open user program  [userprog/addrspace.cc]
+  // Open files are kept by the user programs that open them, in
+  // their own tables (see userprog/fdtable.h)
   OpenFile *Open(char *name)
   {
     int fileDescriptor = OpenForReadWrite(name, FALSE);
@@ -70,61 +68,16 @@ public:
     return new OpenFile(fileDescriptor);
   }
 
-  //  The OpenAFile function is used for kernel open system call
-  OpenFileId OpenAFile(char *name)
-  {
-    int fileDescriptor = OpenForReadWrite(name, FALSE);
-    if (fileDescriptor == -1)
-      return -1;
-    for (int i = 0; i < 20; i++)
-    {
-      if (OpenFileTable[i] == NULL)
-      {
-        OpenFileTable[i] = new OpenFile(fileDescriptor);
-        return i;
-      }
-    }
-    return -1;
-  }
-
-  int Write(char *buffer, int size, OpenFileId id)
-  {
-    if (id < 0 || id >= 20) return -1;
-    OpenFile *openFile = OpenFileTable[id];
-    if (openFile == NULL)
-    {
-      return -1;
-    }
-    int bytes = openFile->Write(buffer, size);
-    return bytes;
-  }
-
-  int Read(char *buffer, int size, OpenFileId id) {
-    if (id < 0 || id >= 20) return -1;
-    OpenFile *openFile = OpenFileTable[id];
-    if (openFile == NULL)
-    {
-      return -1;
-    }
-
-    int result = openFile->Read(buffer, size);
-    return result;
-  }
-
-  int Close(OpenFileId id)
-  {
-    if (id < 0 || id >= 20) return -1;
-    if (OpenFileTable[id] == NULL) return -1;
-    OpenFileTable[id] = NULL;
-    return 1;
-  }
-
   bool Remove(char *name) { return Unlink(name) == 0; }
-
-  OpenFile *OpenFileTable[20];
 };
 
 #else // FILESYS
+class DentryCache;
+class Journal;
+class FileHeader;
+class PersistentBitmap;
+class Lock;
+
 class FileSystem
 {
 public:
@@ -135,22 +88,73 @@ public:
                            // the disk, so initialize the directory
                            // and the bitmap of free blocks.
 
+  ~FileSystem(); // De-allocate the file system.
+
   bool Create(char *name, int initialSize);
   // Create a file (UNIX creat)
 
+  bool Mkdir(char *name); // Create a directory (UNIX mkdir)
+
   OpenFile *Open(char *name); // Open a file (UNIX open)
 
-  bool Remove(char *name); // Delete a file (UNIX unlink)
+  bool Remove(char *name); // Delete a file, or an empty
+                           // directory (UNIX unlink, rmdir)
+
+  void List(); // List all the files in the root directory
 
-  void List(); // List all the files in the file system
+  void List(char *name, bool recursive); // List the files in a directory,
+                                         // and optionally in all of
+                                         // its sub-directories
 
   void Print(); // List all the files and their contents
 
+  void BeginBatch(); // Commit the operations that follow
+  void EndBatch();   // together, as far as the log has room
+                     // (for bulk imports)
+
+  bool Extend(FileHeader *hdr, int hdrSector, int newLength);
+  // Grow an open file; called by
+  // OpenFile::WriteAt
+
+  FileHeader *WriteAside(char *from, int numBytes);
+  // Write new contents for a file to
+  // blocks of their own, and
+  void Switch(FileHeader *hdr, int hdrSector, FileHeader *aside);
+  // give them to the file; called by
+  // OpenFile::WriteAside and Switch
+
+  void Reclaim(FileHeader *hdr, int hdrSector);
+  // Free the space of a removed file;
+  // called when it is last closed
+
 private:
   OpenFile *freeMapFile;   // Bit map of free disk blocks,
                            // represented as a file
+  PersistentBitmap *freeMap; // In-memory copy of the bit map,
+                             // kept up to date on disk
   OpenFile *directoryFile; // "Root" directory -- list of
                            // file names, represented as a file
+  DentryCache *dentryCache; // Recently resolved path components
+  Journal *journal;         // Log of changes to the file system
+  Lock *freeMapLock;        // Held while using the bitmap
+
+  bool CreateEntry(char *name, int initialSize, bool isDirectory);
+  // Common part of Create and Mkdir
+
+  void WriteBackBlocks(FileHeader *hdr);
+  // Write back a file's changed doubly
+  // indirect blocks, a few per operation
+
+  int FindParent(char *name, char *leafName);
+  // Resolve all but the last component of a path
+
+  int Lookup(int dirSector, char *name, bool *isDirectory);
+  // Find one name in one directory
+
+  OpenFile *OpenDirectory(int sector);
+  // Open the directory file whose header is at "sector"
+  void CloseDirectory(OpenFile *dirFile);
+  // Close a file returned by OpenDirectory
 };
 
 #endif // FILESYS
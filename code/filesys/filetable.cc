@@ -0,0 +1,171 @@
+// filetable.cc 
+//	Routines to manage the table of open files, and the file
+//	headers they share.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+#ifndef FILESYS_STUB
+
+#include "copyright.h"
+#include "filetable.h"
+#include "filehdr.h"
+#include "synch.h"
+#include "debug.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// EntryGetKey, SectorHash
+// 	Helper routines used by the hash table to find an entry's key,
+//	and to hash a key.
+//----------------------------------------------------------------------
+
+static int
+EntryGetKey(OpenFileEntry *entry)
+{
+    return entry->sector;
+}
+
+static unsigned
+SectorHash(int sector)
+{
+    return (unsigned) sector * 2654435761u;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::OpenFileTable
+// 	Initialize an empty open file table.
+//----------------------------------------------------------------------
+
+OpenFileTable::OpenFileTable()
+{
+    table = new HashTable<int, OpenFileEntry *>(EntryGetKey, SectorHash);
+    lock = new Lock("open file table lock");
+    loaded = new Condition("open file loaded");
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::~OpenFileTable
+// 	De-allocate the open file table, at shutdown.  Headers of files
+//	that are still open are thrown away; a removed file that is still
+//	open is not freed, so its space is lost.
+//----------------------------------------------------------------------
+
+OpenFileTable::~OpenFileTable()
+{
+    while (!table->IsEmpty()) {
+	HashIterator<int, OpenFileEntry *> iter(table);
+	OpenFileEntry *entry = iter.Item();
+
+	table->Remove(entry->sector);
+	delete entry->hdr;
+	delete entry->lock;
+	delete entry;
+    }
+    delete table;
+    delete lock;
+    delete loaded;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::Open
+// 	Return the table entry, with the in-memory header and the lock,
+//	of the file whose header is at "sector".  If the file is already
+//	open, share its entry; otherwise read the header in from disk.
+//
+//	The entry goes in the table before the header is read, without
+//	holding the table's lock during the disk read; a thread opening
+//	the same file meanwhile finds it, and waits for the header.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+OpenFileEntry *
+OpenFileTable::Open(int sector)
+{
+    OpenFileEntry *entry;
+
+    lock->Acquire();
+    if (!table->Find(sector, &entry)) {
+	entry = new OpenFileEntry;
+	entry->sector = sector;
+	entry->hdr = new FileHeader;
+	entry->lock = new RWLock("open file");
+	entry->refCount = 1;
+	entry->removed = FALSE;
+	entry->loading = TRUE;
+	table->Insert(entry);
+	lock->Release();
+	entry->hdr->FetchFrom(sector);
+	lock->Acquire();
+	entry->loading = FALSE;
+	loaded->Broadcast(lock);
+    } else {
+	entry->refCount++;
+	while (entry->loading)
+	    loaded->Wait(lock);
+    }
+    DEBUG(dbgFile, "File at sector " << sector << " open "
+				<< entry->refCount << " times");
+    lock->Release();
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::Close
+// 	Give back an entry returned by Open.  If no one else is using
+//	it, throw it away -- and if the file has been removed, give its
+//	space back to the file system (see FileSystem::Reclaim).  That
+//	is done once the entry is out of the table, without holding its
+//	lock.
+//
+//	"sector" -- the location on disk of the file header
+//----------------------------------------------------------------------
+
+void
+OpenFileTable::Close(int sector)
+{
+    OpenFileEntry *entry;
+    bool found;
+
+    lock->Acquire();
+    found = table->Find(sector, &entry);
+    ASSERT(found && entry->refCount > 0 && !entry->loading);
+    if (--entry->refCount > 0) {
+	lock->Release();
+	return;
+    }
+    table->Remove(sector);
+    lock->Release();
+    if (entry->removed)
+	kernel->fileSystem->Reclaim(entry->hdr, sector);
+    delete entry->hdr;
+    delete entry->lock;
+    delete entry;
+}
+
+//----------------------------------------------------------------------
+// OpenFileTable::MarkRemoved
+// 	Called when the file whose header is at "sector" is removed
+//	from its directory.  If it is open, remember to free its space
+//	once it is closed for the last time, and return TRUE.  Return
+//	FALSE if it isn't open, so the caller can free it right away.
+//----------------------------------------------------------------------
+
+bool
+OpenFileTable::MarkRemoved(int sector)
+{
+    OpenFileEntry *entry;
+    bool found;
+
+    lock->Acquire();
+    found = table->Find(sector, &entry);
+    if (found) {
+	DEBUG(dbgFile, "File at sector " << sector << " removed while open");
+	entry->removed = TRUE;
+    }
+    lock->Release();
+    return found;
+}
+
+#endif // FILESYS_STUB
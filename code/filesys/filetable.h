@@ -0,0 +1,82 @@
+// filetable.h 
+//	Data structures for the system-wide table of open files.
+//
+//	A file may be open several times at once, by several threads.
+//	Each OpenFile has its own position in the file, but they all
+//	share a single copy of the file's header, kept here, so that
+//	when one of them makes the file grow, the others see it at once
+//	(and the header is only read from disk by the first Open).
+//	The table counts how many OpenFiles use each header, and throws
+//	the header away when the last of them is closed.
+//
+//	Each open file also has a reader-writer lock, shared like the
+//	header: any number of threads may read the file at once, but a
+//	thread writing it (or changing it, if it is a directory) has it
+//	to itself.
+//
+//	A file that is removed while it is open stays on disk, without
+//	a name, until it is closed for the last time; only then is its
+//	space given back to the file system.
+//
+//	The table has a lock of its own, since threads may open the same
+//	file at the same time.  The first to open a file puts its entry
+//	in the table before reading the header in; anyone else opening
+//	it meanwhile waits for the header, so there is only ever one
+//	header, and one lock, per file.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef FILETABLE_H
+#define FILETABLE_H
+
+#include "hash.h"
+
+class FileHeader;
+class RWLock;
+class Lock;
+class Condition;
+
+// The following class defines one open file in the table.
+
+class OpenFileEntry {
+  public:
+    int sector;				// Where the file header is on disk
+    FileHeader *hdr;			// The shared, in-memory header
+    RWLock *lock;			// Serializes writers of the file
+    int refCount;			// Number of OpenFiles using it
+    bool removed;			// Has the file been removed?
+    bool loading;			// Is the header still being read?
+};
+
+// The following class defines the open file table.
+
+class OpenFileTable {
+  public:
+    OpenFileTable();			// Initialize an empty table
+    ~OpenFileTable();			// De-allocate the table
+
+    OpenFileEntry *Open(int sector);	// Return the header and lock of
+					// the file at "sector", reading
+					// the header in if the file isn't
+					// already open
+    void Close(int sector);		// Done with the entry returned
+					// by Open
+
+    bool MarkRemoved(int sector);	// If the file at "sector" is open,
+					// free it on its last Close, and
+					// return TRUE; otherwise the caller
+					// must free it now
+
+  private:
+    HashTable<int, OpenFileEntry *> *table;	// Open files, by sector
+    Lock *lock;				// Protects the table and its
+					// entries' counts
+    Condition *loaded;			// Signalled when a header has
+					// been read in
+};
+
+#endif // FILETABLE_H
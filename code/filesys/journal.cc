@@ -0,0 +1,405 @@
+// journal.cc
+//	Routines to manage the file system's write-ahead log.
+//
+//	The log on disk is a header, followed by room for as many
+//	sectors as the header can list.  The header is one sector,
+//	unless the disk is so big that an operation may write more
+//	sectors than one header sector can list.  A transaction is
+//	committed in four steps:
+//	   write each changed sector to the log
+//	   write the header, listing where each sector belongs -- the
+//		first header sector last, since it holds the count;
+//		once that single sector write is done, the transaction
+//		will survive a crash
+//	   write each changed sector to where it belongs
+//	   write the header again, with no entries
+//
+//	Recover repeats the last two steps if it finds a header with
+//	entries in it, which is harmless if they were already done.
+//
+//	If the disk's UNIX file is mapped into memory, the host may
+//	write the changed pages out to the file in any order, so each
+//	step is forced out (see SynchDisk::Sync) before the next one
+//	starts; otherwise a crash of the host could leave a header
+//	that commits sectors never written to the log, or clear the log
+//	before the sectors it held reached their homes.
+//
+//	Only one transaction is committed at a time; operations that
+//	start meanwhile wait for it, and so does writing file data to a
+//	sector being installed (see Journal::Update).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "journal.h"
+#include "synchdisk.h"
+#include "debug.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// Journal::Journal
+// 	Initialize an empty transaction, for a log kept on disk starting
+//	at "sector".  Call Format or Recover before using it.
+//
+//	The header is made just long enough to list "opSectors" sectors,
+//	and the log holds as many as the header can list -- so for the
+//	usual disk, a one sector header, and room for several operations.
+//
+//	"opSectors" -- the most sectors an operation writes; Begin sets
+//		this much of the log aside for each one
+//----------------------------------------------------------------------
+
+Journal::Journal(int sector, int opSectors)
+{
+    const int wordsPerSector = SectorSize / sizeof(int);
+
+    logSector = sector;
+    headerSectors = divRoundUp(HeaderHomes + opSectors, wordsPerSector);
+    capacity = headerSectors * wordsPerSector - HeaderHomes;
+    header = new int[headerSectors * wordsPerSector];
+    header[HeaderMagic] = LogMagic;
+    header[HeaderCount] = 0;
+    blocks = new char[capacity * SectorSize];
+    reserve = opSectors;
+    outstanding = 0;
+    inProgress = new List<Thread *>;
+    held = 0;
+    committing = FALSE;
+    lock = new Lock("journal lock");
+    changed = new Condition("journal changed");
+}
+
+//----------------------------------------------------------------------
+// Journal::~Journal
+// 	De-allocate the log.  Any transaction has already been committed.
+//----------------------------------------------------------------------
+
+Journal::~Journal()
+{
+    ASSERT((outstanding == 0) && (held == 0));
+    delete [] header;
+    delete [] blocks;
+    delete inProgress;
+    delete lock;
+    delete changed;
+}
+
+//----------------------------------------------------------------------
+// Journal::Format
+// 	Write an empty log header to disk, when the disk is formatted.
+//----------------------------------------------------------------------
+
+void
+Journal::Format()
+{
+    header[HeaderMagic] = LogMagic;
+    header[HeaderCount] = 0;
+    kernel->synchDisk->WriteSector(logSector, (char *)header);
+}
+
+//----------------------------------------------------------------------
+// Journal::Recover
+// 	Read the log header from disk.  If a transaction was committed
+//	to the log, but we crashed before it was all written home,
+//	write it home now.  Return FALSE if there is no log on the disk
+//	(for instance, it was formatted by an older version of Nachos).
+//----------------------------------------------------------------------
+
+bool
+Journal::Recover()
+{
+    kernel->synchDisk->ReadSector(logSector, (char *)header);
+    if (header[HeaderMagic] != LogMagic) {
+	header[HeaderMagic] = LogMagic;
+	header[HeaderCount] = 0;
+	return FALSE;
+    }
+    if (header[HeaderCount] > 0) {
+	DEBUG(dbgFile, "Replaying " << header[HeaderCount]
+					<< " sectors from the log");
+	ASSERT(header[HeaderCount] <= capacity);
+	if (headerSectors > 1)
+	    kernel->synchDisk->ReadSectors(logSector + 1, headerSectors - 1,
+					(char *)header + SectorSize);
+	kernel->synchDisk->ReadSectors(logSector + headerSectors,
+					header[HeaderCount], blocks);
+	Install();
+	kernel->synchDisk->Sync();
+	header[HeaderCount] = 0;
+	kernel->synchDisk->WriteSector(logSector, (char *)header);
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Begin
+// 	Start a file system operation, first waiting until there is
+//	room for it in the log, and the log isn't being written out.
+//	If there is no room only because commits are being held back
+//	(see HoldCommits), commit now rather than wait.
+//
+//	An operation may call Begin again before its End (Remove frees
+//	the file's space with FileSystem::Reclaim, which is itself an
+//	operation); the inner one just becomes part of the outer one.
+//----------------------------------------------------------------------
+
+void
+Journal::Begin()
+{
+    Thread *thread = kernel->currentThread;
+
+    lock->Acquire();
+    if (!inProgress->IsInList(thread)) {
+	while (!Fits()) {
+	    if (!committing && (outstanding == 0))
+		Flush();
+	    else
+		changed->Wait(lock);
+	}
+	outstanding++;
+    }
+    inProgress->Append(thread);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::End
+// 	Finish a file system operation.  If it was the last one
+//	outstanding, commit everything the operations changed, unless
+//	commits are being held back.
+//----------------------------------------------------------------------
+
+void
+Journal::End()
+{
+    Thread *thread = kernel->currentThread;
+
+    lock->Acquire();
+    inProgress->Remove(thread);
+    if (!inProgress->IsInList(thread)) {	// not nested in another
+	outstanding--;
+	if ((outstanding == 0) && (held == 0))
+	    Flush();
+	else
+	    changed->Broadcast(lock);	// its room is free again
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::HoldCommits
+// Journal::ReleaseCommits
+// 	Bracket a series of operations whose changes should be committed
+//	together, rather than whenever no operation is outstanding.
+//	The log is still committed whenever it hasn't room for another
+//	operation, so each commit holds only whole operations, and each
+//	of them is protected from crashes as usual.
+//----------------------------------------------------------------------
+
+void
+Journal::HoldCommits()
+{
+    lock->Acquire();
+    held++;
+    lock->Release();
+}
+
+void
+Journal::ReleaseCommits()
+{
+    lock->Acquire();
+    ASSERT(held > 0);
+    held--;
+    if ((held == 0) && (outstanding == 0))
+	Flush();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Fits
+// 	Return TRUE if another operation may start: the log isn't being
+//	written out, and there is room left for the new one, on top of
+//	what every operation in progress may still write.  Called with
+//	"lock" held.
+//----------------------------------------------------------------------
+
+bool
+Journal::Fits()
+{
+    if (committing)
+	return FALSE;
+    return header[HeaderCount] + (outstanding + 1) * reserve <= capacity;
+}
+
+//----------------------------------------------------------------------
+// Journal::Find
+// 	Return where "sector" is in the current transaction, or -1.
+//----------------------------------------------------------------------
+
+int
+Journal::Find(int sector)
+{
+    for (int i = 0; i < header[HeaderCount]; i++)
+	if (header[HeaderHomes + i] == sector)
+	    return i;
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Journal::Absorb
+// 	Called by SynchDisk::WriteLogged.  If the current thread is in
+//	the middle of an operation, add the sector to the transaction
+//	instead of writing it, and return TRUE.  Return FALSE if the
+//	caller should write it to disk itself, as usual.
+//
+//	Begin set aside enough room for the operation, so the log never
+//	fills up in the middle of one; an operation that writes more
+//	than that is a bug in the file system.
+//
+//	"sector" -- the disk sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+bool
+Journal::Absorb(int sector, char *data)
+{
+    int i;
+
+    lock->Acquire();
+    if (!inProgress->IsInList(kernel->currentThread)) {
+	lock->Release();
+	return FALSE;
+    }
+    i = Find(sector);
+    if (i == -1) {
+	ASSERT(header[HeaderCount] < capacity);
+	i = header[HeaderCount]++;
+	header[HeaderHomes + i] = sector;
+    }
+    bcopy(data, &blocks[i * SectorSize], SectorSize);
+    lock->Release();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Update
+// 	Called by SynchDisk::WriteSector, for a sector written straight
+//	to disk.  If the sector is in the transaction, replace the logged
+//	copy, so that installing the log later doesn't undo the write.
+//	If the log is being written out, the old copy may already be in
+//	the log on disk, so wait until it has been installed instead:
+//	the caller's write then lands on top of it.
+//
+//	"sector" -- the disk sector being written
+//	"data" -- its new contents
+//----------------------------------------------------------------------
+
+void
+Journal::Update(int sector, char *data)
+{
+    int i;
+
+    if (Find(sector) == -1)
+	return;				// the usual case
+    lock->Acquire();
+    while (committing)
+	changed->Wait(lock);
+    i = Find(sector);
+    if (i != -1)
+	bcopy(data, &blocks[i * SectorSize], SectorSize);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// Journal::Lookup
+// 	Called by SynchDisk::ReadSector.  If the sector has a newer copy
+//	in the current transaction, copy it into "data" and return TRUE.
+//----------------------------------------------------------------------
+
+bool
+Journal::Lookup(int sector, char *data)
+{
+    int i = Find(sector);
+
+    if (i == -1)
+	return FALSE;
+    bcopy(&blocks[i * SectorSize], data, SectorSize);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Journal::Flush
+// 	Commit the current transaction.  Called with "lock" held, which
+//	is let go while the log is written out; meanwhile, no operation
+//	can start.
+//----------------------------------------------------------------------
+
+void
+Journal::Flush()
+{
+    committing = TRUE;
+    lock->Release();
+    Commit();
+    lock->Acquire();
+    committing = FALSE;
+    changed->Broadcast(lock);
+}
+
+//----------------------------------------------------------------------
+// Journal::Commit
+// 	Write the current transaction to the log, mark it committed,
+//	and then write each sector to where it belongs.  The logged
+//	sectors are written in order, to consecutive sectors, so they go
+//	to the disk as a single request.  Any header sectors after the
+//	first that the transaction needs go out before the first one,
+//	which commits it.
+//----------------------------------------------------------------------
+
+void
+Journal::Commit()
+{
+    int count = header[HeaderCount];
+    int more = divRoundUp(HeaderHomes + count,
+				(int) (SectorSize / sizeof(int))) - 1;
+
+    if (count == 0)
+	return;
+    DEBUG(dbgFile, "Committing " << count << " sectors");
+    kernel->synchDisk->WriteSectors(logSector + headerSectors, count,
+					blocks);
+    if (more > 0)
+	kernel->synchDisk->WriteSectors(logSector + 1, more,
+					(char *)header + SectorSize);
+    kernel->synchDisk->Sync();
+    kernel->synchDisk->WriteSector(logSector, (char *)header);	// commit
+    kernel->synchDisk->Sync();
+    Install();
+    kernel->synchDisk->Sync();
+    header[HeaderCount] = 0;
+    kernel->synchDisk->WriteSector(logSector, (char *)header);	// clear
+}
+
+//----------------------------------------------------------------------
+// Journal::Install
+// 	Write each sector in the transaction to its home on disk.
+//	Homes that happen to be consecutive are written together.
+//	The sectors are still in the log, so this goes straight to the
+//	disk (a SynchDisk::WriteSectors would wait for the commit to end).
+//----------------------------------------------------------------------
+
+void
+Journal::Install()
+{
+    int first, n;
+
+    for (first = 0; first < header[HeaderCount]; first += n) {
+	n = 1;
+	while ((first + n < header[HeaderCount]) && (header[HeaderHomes
+			+ first + n] == header[HeaderHomes + first] + n))
+	    n++;
+	kernel->synchDisk->Transfer(TRUE, header[HeaderHomes + first], n,
+					&blocks[first * SectorSize]);
+    }
+}
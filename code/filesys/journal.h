@@ -0,0 +1,127 @@
+// journal.h
+//	Data structures for the file system's write-ahead log.
+//
+//	File system operations like Create and Remove change several
+//	sectors -- a file header, a directory, the bitmap of free
+//	sectors.  If Nachos stops in the middle, the disk is left with
+//	only some of the changes.  To avoid this, the sectors changed by
+//	an operation are first written to a log, a fixed region of the
+//	disk; only once the whole operation is in the log are the
+//	sectors written to where they belong.  When the file system is
+//	mounted, any operation found complete in the log is written out
+//	again, and any incomplete one is forgotten.
+//
+//	An operation is bracketed by Begin and End.  In between, the
+//	sectors of the file system's own data structures -- file headers
+//	and their indirect blocks, directories, the bitmap -- are written
+//	with SynchDisk::WriteLogged, which hands them to the log; the
+//	sector stays in memory until the log is committed, and reads of
+//	it are served from there.  Writing the same sector again within
+//	a transaction just replaces the logged copy.  The log is
+//	committed when the last outstanding operation ends, so
+//	operations by several threads that overlap are committed
+//	together, in one sequential write.
+//
+//	The data in files is written to disk directly, with
+//	SynchDisk::WriteSector.  If the sector happens to be in the log
+//	too (it held a directory, say, that was removed, and it has
+//	been given to a file since), the logged copy is brought up to
+//	date, so that installing the log doesn't undo the write.
+//
+//	So that the log can't fill up in the middle of an operation,
+//	Begin sets aside room for the most sectors an operation writes,
+//	waiting if there isn't that much left.  The log is made big
+//	enough for at least one such operation, however big the disk
+//	(and so the bitmap) is; the file system keeps every operation
+//	within that bound, doing anything bigger -- re-writing a whole
+//	directory, say -- ahead of time, where nothing on disk points to
+//	it yet (see FileSystem::WriteAside).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "disk.h"
+#include "synch.h"
+#include "list.h"
+
+#define LogMagic	0x4c4f4721	// marks a sector as a log header
+
+// The log header is stored on disk in the first sectors of the log.
+// It is an array of ints: LogMagic, the number of sectors in the
+// transaction, and the home location of each of them.  A header with
+// a non-zero number of sectors means the sectors that follow it in
+// the log have not all been written to their homes yet.  The header
+// is as many sectors long as it takes to list the sectors of one
+// operation; the number of sectors is in the first, so that writing
+// it commits the transaction.
+
+#define HeaderMagic	0		// LogMagic, if there is a log
+#define HeaderCount	1		// Number of sectors in the log
+#define HeaderHomes	2		// Home location of each of them
+
+// The following class defines the log, and the transaction that is
+// being built up in memory.
+
+class Journal {
+  public:
+    Journal(int sector, int opSectors);	// Initialize a log kept at "sector"
+					// and the sectors after it, setting
+					// aside "opSectors" per operation
+    ~Journal();				// De-allocate the log
+
+    int Size() { return headerSectors + capacity; }
+					// Number of sectors the log takes
+					// up on disk
+
+    void Format();			// Write an empty log to disk
+    bool Recover();			// Finish any operation committed
+					// to the log on disk; return FALSE
+					// if the disk has no log
+
+    void Begin();			// Start a file system operation
+    void End();				// Finish one, committing the log
+					// if no others are outstanding
+    void HoldCommits();			// Keep the operations that follow
+    void ReleaseCommits();		// in the log, until released,
+					// committing only when it is full
+
+    bool Absorb(int sector, char *data);// Take a sector being written by
+					// the current thread's operation
+    void Update(int sector, char *data);// Note a sector written straight
+					// to disk
+    bool Lookup(int sector, char *data);// Read a sector that is in the
+					// log but not yet on disk
+
+  private:
+    int logSector;			// Where the log header is on disk
+    int headerSectors;			// Length of the header, in sectors
+    int capacity;			// Most sectors a transaction holds
+    int *header;			// Sectors in the current transaction
+    char *blocks;			// Their new contents
+    int reserve;			// Log sectors set aside for each
+					// operation
+    int outstanding;			// Number of operations in progress
+    List<Thread *> *inProgress;		// Threads in an operation, once
+					// for each Begin not yet ended
+    int held;				// HoldCommits not yet released
+    bool committing;			// Is the log being written out?
+    Lock *lock;				// Protects all of the above
+    Condition *changed;			// Signalled when an operation ends,
+					// or a commit is done
+
+    int Find(int sector);		// Index of "sector" in the log,
+					// or -1
+    bool Fits();			// Is there room for an operation?
+    void Flush();			// Commit, with "lock" held
+    void Commit();			// Write the transaction to the log,
+					// then to its home sectors
+    void Install();			// Copy the logged sectors home
+};
+
+#endif // JOURNAL_H
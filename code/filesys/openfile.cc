@@ -5,7 +5,10 @@
 //	the OpenFile data structure).
 //
 //	Also as in UNIX, for convenience, we keep the file header in
-//	memory while the file is open.
+//	memory while the file is open.  If the file is open several
+//	times, the header is shared (see filetable.h), and so is a
+//	reader-writer lock: reads of the file run at the same time, but
+//	a write (which may also grow the file) excludes everything else.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -17,30 +20,39 @@
 #include "filehdr.h"
 #include "openfile.h"
 #include "synchdisk.h"
+#include "filetable.h"
+#include "synch.h"
 
 //----------------------------------------------------------------------
 // OpenFile::OpenFile
 // 	Open a Nachos file for reading and writing.  Bring the file header
-//	into memory while the file is open.
+//	into memory while the file is open, unless it is already there
+//	because the file is already open.
 //
 //	"sector" -- the location on disk of the file header for this file
 //----------------------------------------------------------------------
 
 OpenFile::OpenFile(int sector)
 { 
-    hdr = new FileHeader;
-    hdr->FetchFrom(sector);
+    OpenFileEntry *entry = kernel->openFileTable->Open(sector);
+
+    hdr = entry->hdr;
+    lock = entry->lock;
+    hdrSector = sector;
     seekPosition = 0;
+    aside = NULL;
 }
 
 //----------------------------------------------------------------------
 // OpenFile::~OpenFile
-// 	Close a Nachos file, de-allocating any in-memory data structures.
+// 	Close a Nachos file, de-allocating any in-memory data structures
+//	no other OpenFile is using.
 //----------------------------------------------------------------------
 
 OpenFile::~OpenFile()
 {
-    delete hdr;
+    ASSERT(aside == NULL);
+    kernel->openFileTable->Close(hdrSector);
 }
 
 //----------------------------------------------------------------------
@@ -96,14 +108,25 @@ OpenFile::Write(char *into, int numBytes)
 //	boundary; however the disk only knows how to read/write a whole disk
 //	sector at a time.  Thus:
 //
+//	Sectors that are entirely covered by the request are transferred
+//	directly to or from the caller's buffer, without any copying;
+//	each run of them that is consecutive on disk goes to the disk as
+//	one request.
+//	At most two sectors -- the first and the last -- can be partially
+//	covered; these go through the current thread's scratch sector:
+//
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   We read the partial sector into the scratch buffer, and copy
+//	   out only the part we are interested in.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   We must first read in the partial sector, so that we don't
+//	   overwrite the unmodified portion.  We then copy in the data
+//	   that will be modified, and write the whole sector back.
+//
+//	A write that goes past the end of the file first extends the
+//	file (see FileSystem::Extend).  If the write starts beyond the
+//	old end of the file, the gap is filled with zeroes.  If the disk
+//	is full, we write as much as fits in the file as it was.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -114,9 +137,92 @@ OpenFile::Write(char *into, int numBytes)
 
 int
 OpenFile::ReadAt(char *into, int numBytes, int position)
+{
+    int result;
+
+    lock->AcquireRead();
+    result = ReadAtLocked(into, numBytes, position);
+    lock->ReleaseRead();
+    return result;
+}
+
+int
+OpenFile::WriteAt(char *from, int numBytes, int position)
+{
+    int result;
+
+    lock->AcquireWrite();
+    result = WriteAtLocked(from, numBytes, position);
+    lock->ReleaseWrite();
+    return result;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::WriteLogged
+// 	Like WriteAt, but for a directory or the bitmap of free sectors:
+//	each sector written goes through the log (see
+//	SynchDisk::WriteLogged), so it is part of the file system
+//	operation under way.
+//----------------------------------------------------------------------
+
+int
+OpenFile::WriteLogged(char *from, int numBytes, int position)
+{
+    int result;
+
+    lock->AcquireWrite();
+    result = WriteAtLocked(from, numBytes, position, TRUE);
+    lock->ReleaseWrite();
+    return result;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::WriteAside
+// OpenFile::Switch
+// 	Replace the whole contents of a file -- a directory that has
+//	been re-hashed -- in two steps: first,
+//	before the file system operation begins, write them to newly
+//	allocated blocks (see FileSystem::WriteAside), which nothing
+//	on disk points to yet, so they need not go through the log;
+//	then, as part of the operation, point the file at them and
+//	free the old ones.  Only the second step is logged, and it
+//	writes a few sectors, however big the file is.
+//
+//	WriteAside returns FALSE, leaving nothing to Switch to, if there
+//	isn't room on the disk for the new contents.
+//----------------------------------------------------------------------
+
+bool
+OpenFile::WriteAside(char *from, int numBytes)
+{
+    ASSERT(aside == NULL);
+    aside = kernel->fileSystem->WriteAside(from, numBytes);
+    return aside != NULL;
+}
+
+void
+OpenFile::Switch()
+{
+    ASSERT(aside != NULL);
+    lock->AcquireWrite();
+    kernel->fileSystem->Switch(hdr, hdrSector, aside);
+    lock->ReleaseWrite();
+    aside = NULL;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAtLocked/WriteAtLocked
+// 	Do the work of ReadAt/WriteAt, once the file is locked.
+//	If "logged", each sector is written on its own, through the log.
+//----------------------------------------------------------------------
+
+int
+OpenFile::ReadAtLocked(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
+    int i, firstSector, lastSector;
+    int start, end, sectorStart, sector;
+    int runSector, runLength, runStart;
     char *buf;
 
     if ((numBytes <= 0) || (position >= fileLength))
@@ -127,59 +233,131 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
+    runSector = runLength = runStart = 0;
 
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    for (i = firstSector; i <= lastSector; i++) {
+	sectorStart = i * SectorSize;
+	start = max(position, sectorStart);
+	end = min(position + numBytes, sectorStart + SectorSize);
+	if ((start == sectorStart) && (end == sectorStart + SectorSize)) {
+	    // whole sector wanted, read it straight into place, along
+	    // with the ones next to it on disk
+	    sector = hdr->ByteToSector(sectorStart);
+	    if ((runLength > 0) && (sector == runSector + runLength)) {
+		runLength++;
+		continue;
+	    }
+	    if (runLength > 0)
+		kernel->synchDisk->ReadSectors(runSector, runLength,
+					&into[runStart - position]);
+	    runSector = sector;
+	    runLength = 1;
+	    runStart = sectorStart;
+	} else {
+	    buf = kernel->currentThread->ScratchSector();
+	    kernel->synchDisk->ReadSector(hdr->ByteToSector(sectorStart), buf);
+	    bcopy(&buf[start - sectorStart], &into[start - position],
+							end - start);
+	}
+    }
+    if (runLength > 0)
+	kernel->synchDisk->ReadSectors(runSector, runLength,
+					&into[runStart - position]);
     return numBytes;
 }
 
 int
-OpenFile::WriteAt(char *from, int numBytes, int position)
+OpenFile::WriteAtLocked(char *from, int numBytes, int position, bool logged)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
+    int i, firstSector, lastSector;
+    int start, end, sectorStart, sector;
+    int runSector, runLength, runStart;
     char *buf;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if (numBytes <= 0)
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength) {
+	if (kernel->fileSystem->Extend(hdr, hdrSector, position + numBytes)) {
+	    ZeroFill(fileLength, position);
+	    fileLength = position + numBytes;
+	} else if (position >= fileLength) {
+	    return 0;				// no room to grow
+	} else {
+	    numBytes = fileLength - position;
+	}
+    }
     DEBUG(dbgFile, "Writing " << numBytes << " bytes at " << position << " from file of length " << fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    buf = new char[numSectors * SectorSize];
+    runSector = runLength = runStart = 0;
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    for (i = firstSector; i <= lastSector; i++) {
+	sectorStart = i * SectorSize;
+	start = max(position, sectorStart);
+	end = min(position + numBytes, sectorStart + SectorSize);
+	if ((start == sectorStart) && (end == sectorStart + SectorSize)) {
+	    // whole sector overwritten, write it straight from the caller,
+	    // along with the ones next to it on disk
+	    sector = hdr->ByteToSector(sectorStart);
+	    if (logged) {
+		kernel->synchDisk->WriteLogged(sector,
+					&from[sectorStart - position]);
+		continue;
+	    }
+	    if ((runLength > 0) && (sector == runSector + runLength)) {
+		runLength++;
+		continue;
+	    }
+	    if (runLength > 0)
+		kernel->synchDisk->WriteSectors(runSector, runLength,
+					&from[runStart - position]);
+	    runSector = sector;
+	    runLength = 1;
+	    runStart = sectorStart;
+	} else {
+	    // partial sector: read in the old contents, and merge
+	    buf = kernel->currentThread->ScratchSector();
+	    kernel->synchDisk->ReadSector(hdr->ByteToSector(sectorStart), buf);
+	    bcopy(&from[start - position], &buf[start - sectorStart],
+							end - start);
+	    if (logged)
+		kernel->synchDisk->WriteLogged(hdr->ByteToSector(sectorStart),
+									buf);
+	    else
+		kernel->synchDisk->WriteSector(hdr->ByteToSector(sectorStart),
+									buf);
+	}
+    }
+    if (runLength > 0)
+	kernel->synchDisk->WriteSectors(runSector, runLength,
+					&from[runStart - position]);
+    return numBytes;
+}
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+//----------------------------------------------------------------------
+// OpenFile::ZeroFill
+// 	Clear the bytes of the file in [from, to), which have been
+//	allocated but never written.  The file must already be at
+//	least "to" bytes long, and locked for writing.
+//----------------------------------------------------------------------
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+void
+OpenFile::ZeroFill(int from, int to)
+{
+    char *zeroes;
+    int n;
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        kernel->synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+    if (from >= to)
+	return;
+    zeroes = new char[SectorSize];
+    bzero(zeroes, SectorSize);
+    for (; from < to; from += n) {
+	n = min(SectorSize - (from % SectorSize), to - from);
+	(void) WriteAtLocked(zeroes, n, from);
+    }
+    delete [] zeroes;
 }
 
 //----------------------------------------------------------------------
@@ -48,6 +48,16 @@ public:
     WriteFile(file, from, numBytes);
     return numBytes;
   }
+  int WriteLogged(char *from, int numBytes, int position)
+  {
+    return WriteAt(from, numBytes, position);
+  }
+  bool WriteAside(char *from, int numBytes)
+  {
+    WriteAt(from, numBytes, 0);
+    return TRUE;
+  }
+  void Switch() {}
   int Read(char *into, int numBytes)
   {
     int numRead = ReadAt(into, numBytes, currentOffset);
@@ -60,6 +70,7 @@ public:
     currentOffset += numWritten;
     return numWritten;
   }
+  void Seek(int position) { currentOffset = position; }
 
   int Length()
   {
@@ -74,6 +85,7 @@ private:
 
 #else // FILESYS
 class FileHeader;
+class RWLock;
 
 class OpenFile
 {
@@ -94,16 +106,46 @@ public:
   int ReadAt(char *into, int numBytes, int position);
   // Read/write bytes from the file,
   // bypassing the implicit position.
+  // Writing past the end of the file
+  // makes the file grow.
   int WriteAt(char *from, int numBytes, int position);
+  int WriteLogged(char *from, int numBytes, int position);
+  // WriteAt, for a file holding the
+  // file system's own data structures
+  // (a directory, the bitmap): the
+  // sectors go through the log
+  bool WriteAside(char *from, int numBytes);
+  // Write new contents for the whole
+  // file, to blocks of their own; FALSE
+  // if the disk is full
+  void Switch();
+  // Give the file those contents, as
+  // part of the operation under way
 
   int Length(); // Return the number of bytes in the
                 // file (this interface is simpler
                 // than the UNIX idiom -- lseek to
                 // end of file, tell, lseek back
 
+  RWLock *GetLock() { return lock; } // Lock shared by every
+                                     // open of this file
+
 private:
-  FileHeader *hdr;  // Header for this file
+  FileHeader *hdr;  // Header for this file, shared with
+                    // other opens of the same file
+  int hdrSector;    // Sector containing the header on disk
   int seekPosition; // Current position within the file
+  RWLock *lock;     // Held for reading by ReadAt, and for
+                    // writing by WriteAt
+  FileHeader *aside; // Blocks written by WriteAside, not
+                     // yet switched to
+
+  int ReadAtLocked(char *into, int numBytes, int position);
+  int WriteAtLocked(char *from, int numBytes, int position,
+                    bool logged = FALSE);
+  // ReadAt/WriteAt, with the lock held
+
+  void ZeroFill(int from, int to); // Clear the bytes in [from, to)
 };
 
 #endif // FILESYS
@@ -8,6 +8,7 @@
 
 #include "copyright.h"
 #include "pbitmap.h"
+#include "disk.h"
 
 //----------------------------------------------------------------------
 // PersistentBitmap::PersistentBitmap(int)
@@ -21,6 +22,7 @@
 
 PersistentBitmap::PersistentBitmap(int numItems):Bitmap(numItems) 
 { 
+    onDisk = NULL;
 }
 
 //----------------------------------------------------------------------
@@ -40,7 +42,8 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
     // map has already been initialized by the BitMap constructor,
     // but we will just overwrite that with the contents of the
     // map found in the file
-    file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    onDisk = NULL;
+    FetchFrom(file);
 }
 
 //----------------------------------------------------------------------
@@ -50,6 +53,7 @@ PersistentBitmap::PersistentBitmap(OpenFile *file, int numItems):Bitmap(numItems
 
 PersistentBitmap::~PersistentBitmap()
 { 
+    delete [] onDisk;
 }
 
 //----------------------------------------------------------------------
@@ -63,11 +67,21 @@ void
 PersistentBitmap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+    Rebuild();
+    if (onDisk == NULL)
+	onDisk = new unsigned int[numWords];
+    bcopy(map, onDisk, numWords * sizeof(unsigned));
 }
 
 //----------------------------------------------------------------------
 // PersistentBitmap::WriteBack
-// 	Store the contents of a persistent bitmap to a Nachos file.
+// 	Store the contents of a persistent bitmap to a Nachos file,
+//	through the log (see OpenFile::WriteLogged).  Only the sectors
+//	of the file whose bits have changed since they were last read or
+//	written are written again, so that an operation that allocates
+//	or frees a few sectors logs one or two bitmap sectors, however
+//	big the disk is.  A bitmap that has never been written is
+//	written whole.
 //
 //	"file" is the place to write the bitmap to
 //----------------------------------------------------------------------
@@ -75,5 +89,23 @@ PersistentBitmap::FetchFrom(OpenFile *file)
 void
 PersistentBitmap::WriteBack(OpenFile *file)
 {
-   file->WriteAt((char *)map, numWords * sizeof(unsigned), 0);
+    const int wordsPerSector = SectorSize / sizeof(unsigned);
+    int first, count, i;
+
+    if (onDisk == NULL) {
+	file->WriteLogged((char *)map, numWords * sizeof(unsigned), 0);
+	onDisk = new unsigned int[numWords];
+	bcopy(map, onDisk, numWords * sizeof(unsigned));
+	return;
+    }
+    for (first = 0; first < numWords; first += wordsPerSector) {
+	count = min(wordsPerSector, numWords - first);
+	for (i = first; (i < first + count) && (map[i] == onDisk[i]); i++)
+	    ;
+	if (i == first + count)
+	    continue;			// no change in this sector
+	file->WriteLogged((char *)&map[first], count * sizeof(unsigned),
+					first * sizeof(unsigned));
+	bcopy(&map[first], &onDisk[first], count * sizeof(unsigned));
+    }
 }
@@ -29,7 +29,12 @@ class PersistentBitmap : public Bitmap {
     ~PersistentBitmap(); 			// deallocate bitmap
 
     void FetchFrom(OpenFile *file);     // read bitmap from the disk
-    void WriteBack(OpenFile *file); 	// write bitmap contents to disk 
+    void WriteBack(OpenFile *file); 	// write the parts of the bitmap
+					// that changed to disk 
+
+  private:
+    unsigned int *onDisk;		// contents as last read or written,
+					// or NULL if never written
 };
 
 #endif // PBITMAP_H
@@ -10,12 +10,17 @@
 //	handle one operation at a time, use a lock to enforce mutual
 //	exclusion.
 //
+//	A volume passes each request on to the disks it is made of.
+//	To have several disks work at once, it sends a request to each
+//	of them (StartRun) before waiting for any of them (WaitDone).
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "journal.h"
 
 
 //----------------------------------------------------------------------
@@ -23,13 +28,61 @@
 // 	Initialize the synchronous interface to the physical disk, in turn
 //	initializing the physical disk.
 //
+//	"name" -- the UNIX file holding the disk
+//	"sectorsPerTrack", "numTracks" -- the geometry, if the disk is new
+//	"mapped" -- should the disk's UNIX file be mapped into memory?
 //----------------------------------------------------------------------
 
-SynchDisk::SynchDisk()
+SynchDisk::SynchDisk(char *name, int sectorsPerTrack, int numTracks,
+			bool mapped)
 {
     semaphore = new Semaphore("synch disk", 0);
     lock = new Lock("synch disk lock");
-    disk = new Disk(this);
+    disk = new Disk(name, sectorsPerTrack, numTracks, this, mapped);
+    members = NULL;
+    numMembers = 0;
+    layout = Striped;
+    nextMember = 0;
+    numSectors = disk->NumSectors();
+    journal = NULL;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::SynchDisk
+// 	Initialize a volume on top of several synchronous disks.  The
+//	disks still belong to the caller, who must delete them after
+//	deleting the volume.
+//
+//	"disks" -- the disks making up the volume
+//	"count" -- how many of them there are
+//	"layout" -- whether the disks are striped or mirrored
+//----------------------------------------------------------------------
+
+SynchDisk::SynchDisk(SynchDisk **disks, int count, VolumeLayout layout)
+{
+    int smallest;
+
+    ASSERT(count > 0);
+    semaphore = NULL;
+    lock = NULL;
+    disk = NULL;
+    members = new SynchDisk *[count];
+    numMembers = count;
+    this->layout = layout;
+    nextMember = 0;
+    journal = NULL;
+
+    smallest = disks[0]->NumSectors();
+    for (int i = 0; i < count; i++) {
+	ASSERT(disks[i]->disk != NULL);		// no volumes of volumes
+	members[i] = disks[i];
+	if (disks[i]->NumSectors() < smallest)
+	    smallest = disks[i]->NumSectors();
+    }
+    if (layout == Striped)
+	numSectors = smallest * count;
+    else
+	numSectors = smallest;
 }
 
 //----------------------------------------------------------------------
@@ -40,9 +93,13 @@ SynchDisk::SynchDisk()
 
 SynchDisk::~SynchDisk()
 {
-    delete disk;
-    delete lock;
-    delete semaphore;
+    if (disk != NULL) {
+	delete disk;
+	delete lock;
+	delete semaphore;
+    } else {
+	delete [] members;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -57,10 +114,7 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    ReadSectors(sectorNumber, 1, data);
 }
 
 //----------------------------------------------------------------------
@@ -75,12 +129,238 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, char* data)
 {
+    WriteSectors(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors
+// 	Read a run of consecutive sectors into a buffer.  Return only
+//	after all the data has been read.
+//
+//	"firstSector" -- the first disk sector to read
+//	"count" -- how many sectors to read
+//	"data" -- the buffer to hold their contents, "count" sectors long
+//
+//	A sector with a newer copy in the log is read from there; the
+//	parts of the run on either side of it are read from the disk.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int firstSector, int count, char* data)
+{
+    int start = 0;
+
+    ASSERT((firstSector >= 0) && (count > 0)
+		&& (firstSector + count <= numSectors));
+    for (int i = 0; i < count; i++) {
+	if ((journal == NULL)
+		|| !journal->Lookup(firstSector + i, &data[i * SectorSize]))
+	    continue;
+	if (i > start)
+	    Transfer(FALSE, firstSector + start, i - start,
+					&data[start * SectorSize]);
+	start = i + 1;
+    }
+    if (count > start)
+	Transfer(FALSE, firstSector + start, count - start,
+					&data[start * SectorSize]);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteSectors
+// 	Write a run of consecutive sectors from a buffer.  Return only
+//	after all the data has been written.
+//
+//	"firstSector" -- the first disk sector to write
+//	"count" -- how many sectors to write
+//	"data" -- their new contents, "count" sectors long
+//
+//	Any of the sectors that are also in the log have their logged
+//	copies brought up to date (see Journal::Update).
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteSectors(int firstSector, int count, char* data)
+{
+    ASSERT((firstSector >= 0) && (count > 0)
+		&& (firstSector + count <= numSectors));
+    if (journal != NULL)
+	for (int i = 0; i < count; i++)
+	    journal->Update(firstSector + i, &data[i * SectorSize]);
+    Transfer(TRUE, firstSector, count, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WriteLogged
+// 	Write a sector holding one of the file system's own data
+//	structures -- a file header, an indirect block, part of a
+//	directory or of the bitmap.  If the current thread is in the
+//	middle of a file system operation, the sector goes to the log
+//	(see Journal::Absorb); otherwise it is written as usual.
+//
+//	"sectorNumber" -- the disk sector to be written
+//	"data" -- the new contents of the disk sector
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WriteLogged(int sectorNumber, char* data)
+{
+    ASSERT((sectorNumber >= 0) && (sectorNumber < numSectors));
+    if ((journal != NULL) && journal->Absorb(sectorNumber, data))
+	return;
+    WriteSector(sectorNumber, data);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Transfer
+// 	Read/write a run of consecutive sectors, to/from a buffer, and
+//	wait until it is done.
+//
+//	A disk gets the run as a single request.  On a volume, each disk
+//	gets its part of the run (see MemberRun) as a single request, and
+//	they all work at once.
+//
+//	"writing" -- TRUE to write, FALSE to read
+//	"firstSector" -- the first sector to transfer
+//	"count" -- how many there are
+//	"data" -- the buffer, "count" sectors long
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Transfer(bool writing, int firstSector, int count, char *data)
+{
+    int m, sector, n, offset, stride;
+
+    if (disk != NULL) {
+	StartRun(writing, firstSector, count, data, SectorSize);
+	WaitDone();
+	return;
+    }
+    for (m = 0; m < numMembers; m++)
+	if (MemberRun(m, writing, firstSector, count,
+					&sector, &n, &offset, &stride))
+	    members[m]->StartRun(writing, sector, n, &data[offset], stride);
+    for (m = 0; m < numMembers; m++)
+	if (MemberRun(m, writing, firstSector, count,
+					&sector, &n, &offset, &stride))
+	    members[m]->WaitDone();
+    if (layout == Mirrored && !writing)
+	nextMember = (nextMember + 1) % numMembers;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::MemberRun
+// 	Work out which part of a run of sectors on a volume goes to
+//	disk "m" of the volume.  Return FALSE if none of it does.
+//
+//	On a striped volume, every numMembers'th sector of the run is on
+//	disk m; they are consecutive on the disk, and numMembers sectors
+//	apart in the buffer.  On a mirrored volume, a write goes to every
+//	disk; a read is split into numMembers pieces, the first going to
+//	disk nextMember, the next to the disk after it, and so on.
+//
+//	"m" -- which of the volume's disks
+//	"writing" -- TRUE to write, FALSE to read
+//	"firstSector", "count" -- the run of sectors on the volume
+//	"sector", "n" -- set to the run of sectors on disk m
+//	"offset" -- set to where in the buffer its first sector is
+//	"stride" -- set to how far apart in the buffer its sectors are
+//----------------------------------------------------------------------
+
+bool
+SynchDisk::MemberRun(int m, bool writing, int firstSector, int count,
+			int *sector, int *n, int *offset, int *stride)
+{
+    int k, piece;
+
+    if (layout == Striped) {
+	// the run's first sector on disk m is k sectors into the run
+	k = (m - firstSector % numMembers + numMembers) % numMembers;
+	if (k >= count)
+	    return FALSE;
+	*sector = (firstSector + k) / numMembers;
+	*n = (count - k - 1) / numMembers + 1;
+	*offset = k * SectorSize;
+	*stride = numMembers * SectorSize;
+	return TRUE;
+    }
+    *stride = SectorSize;
+    if (writing) {
+	*sector = firstSector;
+	*n = count;
+	*offset = 0;
+	return TRUE;
+    }
+    piece = (m - nextMember + numMembers) % numMembers;
+    k = piece * count / numMembers;
+    *n = (piece + 1) * count / numMembers - k;
+    if (*n == 0)
+	return FALSE;
+    *sector = firstSector + k;
+    *offset = k * SectorSize;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartRun
+// 	Send the disk a request to read/write a run of consecutive
+//	sectors, without waiting for the request to finish.  The caller
+//	must call WaitDone before sending the disk another request.
+//	Only for a SynchDisk that is not a volume.
+//
+//	"writing" -- TRUE to write, FALSE to read
+//	"sector" -- the first sector to transfer
+//	"count" -- how many there are
+//	"data" -- where the first one's contents are in memory
+//	"stride" -- how far apart in memory the sectors are
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartRun(bool writing, int sector, int count, char *data,
+			int stride)
+{
+    ASSERT(disk != NULL);
     lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
+    if (writing)
+	disk->WriteRequest(sector, count, data, stride);
+    else
+	disk->ReadRequest(sector, count, data, stride);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::WaitDone
+// 	Wait for the request sent by StartRun to finish, and let others
+//	use the disk.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::WaitDone()
+{
     semaphore->P();			// wait for interrupt
     lock->Release();
 }
 
+//----------------------------------------------------------------------
+// SynchDisk::Sync
+// 	Make sure every sector written so far is in the UNIX file that
+//	simulates the disk (this only matters if the file is mapped).
+//	Takes no simulated time.  Called by the log, between the steps
+//	of a commit (see journal.cc).
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Sync()
+{
+    if (disk == NULL) {
+	for (int i = 0; i < numMembers; i++)
+	    members[i]->Sync();
+	return;
+    }
+    lock->Acquire();
+    disk->Sync();
+    lock->Release();
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::CallBack
 // 	Disk interrupt handler.  Wake up any thread waiting for the disk
@@ -15,6 +15,15 @@
 #include "synch.h"
 #include "callback.h"
 
+class Journal;
+
+// How a volume built from several disks spreads its sectors over them.
+
+enum VolumeLayout {
+    Striped,		// RAID-0: sector i is on disk i % n
+    Mirrored		// RAID-1: every sector is on every disk
+};
+
 // The following class defines a "synchronous" disk abstraction.
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
@@ -25,11 +34,40 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// A SynchDisk can also be a "volume", built on top of several other
+// SynchDisks, that looks to its users like a single disk.  A striped
+// volume is as big as all its disks together, and a request goes to
+// just the disk holding the sector.  A mirrored volume is as big as its
+// smallest disk; a write goes to every disk at once, and returns once
+// they are all done, and reads take turns among the disks.  Since each
+// disk has its own lock, requests to different disks run at the same
+// time.
+//
+// ReadSectors and WriteSectors transfer a run of consecutive sectors
+// to or from a buffer, as one request to the disk; on a volume, each
+// disk gets its part of the run as one request, and they work on them
+// at the same time.
+//
+// If the file system has a log (see journal.h), the sectors of its own
+// data structures are written with WriteLogged; during a file system
+// operation they go to the log rather than straight to the disk.
 
 class SynchDisk : public CallBackObj {
+  friend class Journal;			// installs logged sectors with
+					// Transfer
   public:
-    SynchDisk();    		        // Initialize a synchronous disk,
-					// by initializing the raw Disk.
+    SynchDisk(char *name, int sectorsPerTrack = DefaultSectorsPerTrack,
+		int numTracks = DefaultNumTracks, bool mapped = FALSE);
+					// Initialize a synchronous disk,
+					// by initializing the raw Disk
+					// kept in UNIX file "name".
+					// If "mapped", the disk's UNIX
+					// file is mapped into memory.
+    SynchDisk(SynchDisk **disks, int count, VolumeLayout layout);
+					// Initialize a volume made up of
+					// the "count" SynchDisks "disks",
+					// which must not be volumes
     ~SynchDisk();			// De-allocate the synch disk data
     
     void ReadSector(int sectorNumber, char* data);
@@ -39,17 +77,57 @@ class SynchDisk : public CallBackObj {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, char* data);
+
+    void ReadSectors(int firstSector, int count, char* data);
+    void WriteSectors(int firstSector, int count, char* data);
+					// Read/write "count" consecutive
+					// sectors, starting at
+					// "firstSector", into/from "data"
+    void WriteLogged(int sectorNumber, char* data);
+					// Write a sector holding file system
+					// data structures, through the log
+
+    int NumSectors() { return numSectors; }
+					// Size of the disk, in sectors
+
+    void Sync();			// Force all writes so far out to
+					// the UNIX file holding the disk
+
+    void SetJournal(Journal *j) { journal = j; }
+					// Send WriteLogged, and reads,
+					// through the log "j" (or stop,
+					// if "j" is NULL)
     
     void CallBack();			// Called by the disk device interrupt
 					// handler, to signal that the
 					// current disk operation is complete.
 
   private:
-    Disk *disk;		  		// Raw disk device
+    Disk *disk;		  		// Raw disk device, or NULL if
+					// this is a volume
+    SynchDisk **members;		// The disks making up a volume
+    int numMembers;
+    VolumeLayout layout;
+    int nextMember;			// Which mirror to read from next
+    int numSectors;			// Size of the disk or volume
     Semaphore *semaphore; 		// To synchronize requesting thread 
 					// with the interrupt handler
     Lock *lock;		  		// Only one read/write request
 					// can be sent to the disk at a time
+    Journal *journal;			// The file system's log, if any
+
+    void Transfer(bool writing, int firstSector, int count,
+		char *data);		// Read/write sectors, skipping
+					// the log
+    bool MemberRun(int m, bool writing, int firstSector, int count,
+		int *sector, int *n, int *offset, int *stride);
+					// The part of a run of sectors
+					// on a volume that is on disk "m"
+    void StartRun(bool writing, int sector, int count, char *data,
+		int stride);		// Send the disk a request for a
+					// run of sectors, and return
+					// without waiting for it
+    void WaitDone();			// Wait for the request to finish
 };
 
 #endif // SYNCHDISK_H
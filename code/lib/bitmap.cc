@@ -10,6 +10,42 @@
 #include "debug.h"
 #include "bitmap.h"
 
+//----------------------------------------------------------------------
+// LowestBit, CountBits
+// 	Return the number of the lowest set bit in a (non-zero) word,
+//	and the number of set bits in a word.  Compilers that know about
+//	it turn these into single instructions.
+//----------------------------------------------------------------------
+
+static int
+LowestBit(unsigned int word)
+{
+    ASSERT(word != 0);
+#ifdef __GNUC__
+    return __builtin_ctz(word);
+#else
+    int i;
+
+    for (i = 0; !(word & 1); i++)
+	word >>= 1;
+    return i;
+#endif
+}
+
+static int
+CountBits(unsigned int word)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(word);
+#else
+    int count;
+
+    for (count = 0; word != 0; count++)
+	word &= word - 1;		// clear the lowest set bit
+    return count;
+#endif
+}
+
 //----------------------------------------------------------------------
 // BitMap::BitMap
 // 	Initialize a bitmap with "numItems" bits, so that every bit is clear.
@@ -30,9 +66,9 @@ Bitmap::Bitmap(int numItems)
     for (i = 0; i < numWords; i++) {
 	map[i] = 0;		// initialize map to keep Purify happy
     }
-    for (i = 0; i < numBits; i++) {
-        Clear(i);
-    }
+    numFullWords = divRoundUp(numWords, BitsInWord);
+    full = new unsigned int[numFullWords];
+    Rebuild();
 }
 
 //----------------------------------------------------------------------
@@ -42,7 +78,54 @@ Bitmap::Bitmap(int numItems)
 
 Bitmap::~Bitmap()
 { 
-    delete map;
+    delete [] map;
+    delete [] full;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::Rebuild
+// 	Recompute the summary of full words and the count of clear bits,
+//	after the contents of "map" have been replaced wholesale (for
+//	instance, read in from disk).
+//
+//	The unused bits at the end of the last word, and the unused bits
+//	at the end of the summary, are kept set, so that searches never
+//	find them.
+//----------------------------------------------------------------------
+
+void
+Bitmap::Rebuild()
+{
+    int i;
+
+    if (numBits % BitsInWord != 0)
+	map[numWords - 1] |= ~0u << (numBits % BitsInWord);
+    for (i = 0; i < numFullWords; i++)
+	full[i] = 0;
+    if (numWords % BitsInWord != 0)
+	full[numFullWords - 1] = ~0u << (numWords % BitsInWord);
+
+    numClear = 0;
+    for (i = 0; i < numWords; i++) {
+	numClear += BitsInWord - CountBits(map[i]);
+	SetFull(i);
+    }
+    hint = 0;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::SetFull
+// 	Update the summary bit for "word" to say whether all of its bits
+//	are set.
+//----------------------------------------------------------------------
+
+void
+Bitmap::SetFull(int word)
+{
+    if (map[word] == ~0u)
+	full[word / BitsInWord] |= 1u << (word % BitsInWord);
+    else
+	full[word / BitsInWord] &= ~(1u << (word % BitsInWord));
 }
 
 //----------------------------------------------------------------------
@@ -57,7 +140,11 @@ Bitmap::Mark(int which)
 { 
     ASSERT(which >= 0 && which < numBits);
 
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    if (!Test(which)) {
+	map[which / BitsInWord] |= 1u << (which % BitsInWord);
+	numClear--;
+	SetFull(which / BitsInWord);
+    }
 
     ASSERT(Test(which));
 }
@@ -74,7 +161,11 @@ Bitmap::Clear(int which)
 {
     ASSERT(which >= 0 && which < numBits);
 
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    if (Test(which)) {
+	map[which / BitsInWord] &= ~(1u << (which % BitsInWord));
+	numClear++;
+	SetFull(which / BitsInWord);
+    }
 
     ASSERT(!Test(which));
 }
@@ -91,32 +182,135 @@ Bitmap::Test(int which) const
 {
     ASSERT(which >= 0 && which < numBits);
     
-    if (map[which / BitsInWord] & (1 << (which % BitsInWord))) {
+    if (map[which / BitsInWord] & (1u << (which % BitsInWord))) {
 	return TRUE;
     } else {
 	return FALSE;
     }
 }
 
+//----------------------------------------------------------------------
+// Bitmap::FindClearWord
+// 	Return the number of the first word of "map", at or after word
+//	"start" (wrapping around at the end), that has a clear bit in it.
+//	Uses the summary to skip over full words.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindClearWord(int start) const
+{
+    int s = start / BitsInWord;
+    unsigned int avail = ~full[s] & (~0u << (start % BitsInWord));
+
+    // look at the first summary word twice: once from "start" on,
+    // and once (after wrapping around) in full
+    for (int n = 0; n <= numFullWords; n++) {
+	if (avail != 0)
+	    return s * BitsInWord + LowestBit(avail);
+	s = (s + 1) % numFullWords;
+	avail = ~full[s];
+    }
+    return -1;
+}
+
 //----------------------------------------------------------------------
 // Bitmap::FindAndSet
-// 	Return the number of the first bit which is clear.
+// 	Return the number of a bit which is clear.
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	The search starts at the word where the previous one succeeded
+//	("next fit"), and takes the first clear bit in the first word
+//	that has one.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 Bitmap::FindAndSet() 
 {
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    int word, which;
+
+    if (numClear == 0)
+	return -1;
+    word = FindClearWord(hint);
+    ASSERT(word != -1);
+    which = word * BitsInWord + LowestBit(~map[word]);
+    Mark(which);
+    hint = word;
+    return which;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetLowest
+// 	Return the number of the lowest bit which is clear, and set it.
+//	Unlike FindAndSet, the search always starts from the beginning;
+//	the summary still lets it skip full words 32 at a time.
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindAndSetLowest()
+{
+    int word, which;
+
+    if (numClear == 0)
+	return -1;
+    word = FindClearWord(0);
+    ASSERT(word != -1);
+    which = word * BitsInWord + LowestBit(~map[word]);
+    Mark(which);
+    return which;
+}
+
+//----------------------------------------------------------------------
+// Bitmap::FindAndSetRun
+// 	Return the number of the first of "count" consecutive clear
+//	bits, and set them all.  Takes the lowest such run, so that
+//	the start of the bitmap is packed densely.  Whole words that are
+//	full, or empty, are stepped over at once.
+//
+//	If there is no such run, return -1.
+//
+//	"count" is the number of bits wanted
+//----------------------------------------------------------------------
+
+int
+Bitmap::FindAndSetRun(int count)
+{
+    int i, start = 0, run = 0;
+
+    ASSERT(count > 0);
+    if (count > numClear)
+	return -1;
+
+    for (i = 0; (i < numBits) && (run < count); ) {
+	if ((i % BitsInWord) == 0 && map[i / BitsInWord] == ~0u) {
+	    run = 0;			// full word, can't be in a run
+	    i += BitsInWord;
+	} else if ((i % BitsInWord) == 0 && map[i / BitsInWord] == 0
+		&& (i + BitsInWord <= numBits)) {
+	    if (run == 0)
+		start = i;
+	    run += BitsInWord;		// empty word, all in the run
+	    i += BitsInWord;
+	} else {
+	    if (Test(i))
+		run = 0;
+	    else if (run++ == 0)
+		start = i;
+	    i++;
 	}
     }
-    return -1;
+    if (run < count)
+	return -1;
+
+    for (i = start; i < start + count; i++)
+	Mark(i);
+    return start;
 }
 
 //----------------------------------------------------------------------
@@ -128,14 +322,7 @@ Bitmap::FindAndSet()
 int 
 Bitmap::NumClear() const
 {
-    int count = 0;
-
-    for (int i = 0; i < numBits; i++) {
-	if (!Test(i)) {
-	    count++;
-	}
-    }
-    return count;
+    return numClear;
 }
 
 //----------------------------------------------------------------------
@@ -177,9 +364,29 @@ Bitmap::SelfTest()
     ASSERT(Test(0) && Test(31));
 
     ASSERT(FindAndSet() == 1);
+    ASSERT(NumClear() == numBits - 3);
     Clear(0);
     Clear(1);
     Clear(31);
+    ASSERT(NumClear() == numBits);
+
+    Mark(3);				// runs must step around set bits
+    ASSERT(FindAndSetRun(3) == 0);
+    ASSERT(FindAndSetRun(BitsInWord / 2) == 4);
+    ASSERT(NumClear() == numBits - 4 - BitsInWord / 2);
+    for (i = 0; i < 4 + BitsInWord / 2; i++) {
+        Clear(i);
+    }
+
+    Mark(0);				// lowest ignores where the last
+    Mark(2);				// search left off
+    ASSERT(FindAndSet() == 1);
+    Clear(0);
+    ASSERT(FindAndSetLowest() == 0);
+    ASSERT(FindAndSetLowest() == 3);
+    for (i = 0; i < 4; i++) {
+        Clear(i);
+    }
 
     for (i = 0; i < numBits; i++) {
         Mark(i);
@@ -5,6 +5,12 @@
 //	Represented as an array of unsigned integers, on which we do
 //	modulo arithmetic to find the bit we are interested in.
 //
+//	To make finding a clear bit fast, we search a word at a time,
+//	starting from the word where the last search succeeded, and
+//	keep a summary with one bit per word that is completely set,
+//	so that full words can be skipped 32 at a time.  The number of
+//	clear bits is kept up to date as bits are set and cleared.
+//
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
 //
@@ -42,6 +48,11 @@ class Bitmap {
     int FindAndSet();         // Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindAndSetLowest();	// Like FindAndSet, but always return the
+				// lowest clear bit
+    int FindAndSetRun(int count); // Return the # of the first of "count"
+				// consecutive clear bits, and set them.
+				// If there is no such run, return -1.
     int NumClear() const;	// Return the number of clear bits
 
     void Print() const;		// Print contents of bitmap
@@ -54,6 +65,20 @@ class Bitmap {
 				//  multiple of the number of bits in
 				//  a word)
     unsigned int *map;		// bit storage
+
+    void Rebuild();		// Recompute the summary and count after
+				// "map" has been changed directly
+
+  private:
+    unsigned int *full;		// one bit per word of "map", set if
+				// every bit in the word is set
+    int numFullWords;		// number of words of "full"
+    int numClear;		// number of clear bits in "map"
+    int hint;			// word to start the next search at
+
+    void SetFull(int word);	// Update the summary bit for "word"
+    int FindClearWord(int start) const; // Find a word, at or after
+				// "start", with a clear bit
 };
 
 #endif // BITMAP_H
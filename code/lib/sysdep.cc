@@ -33,6 +33,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <cerrno>
+#include <sys/mman.h> // for mapping the disk image into memory
 
 #ifdef SOLARIS
 // KMS
@@ -399,6 +400,44 @@ bool Unlink(char *name)
   return unlink(name);
 }
 
+//----------------------------------------------------------------------
+// MapFile
+// 	Map the first "length" bytes of an open file into our address
+//	space, so that changes to the memory are changes to the file.
+//	Return NULL if the file can't be mapped.
+//----------------------------------------------------------------------
+
+char *MapFile(int fd, int length)
+{
+  void *addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if (addr == MAP_FAILED)
+    return NULL;
+  return (char *)addr;
+}
+
+//----------------------------------------------------------------------
+// SyncMappedFile
+// 	Wait until the changes to a mapped file are written to the file.
+//----------------------------------------------------------------------
+
+void SyncMappedFile(char *addr, int length)
+{
+  int retVal = msync(addr, length, MS_SYNC);
+  ASSERT(retVal == 0);
+}
+
+//----------------------------------------------------------------------
+// UnmapFile
+// 	Remove a mapping made by MapFile.
+//----------------------------------------------------------------------
+
+void UnmapFile(char *addr, int length)
+{
+  int retVal = munmap(addr, length);
+  ASSERT(retVal == 0);
+}
+
 //----------------------------------------------------------------------
 // OpenSocket
 // 	Open an interprocess communication (IPC) connection.  For now,
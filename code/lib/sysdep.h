@@ -52,6 +52,9 @@ extern void Lseek(int fd, int offset, int whence);
 extern int Tell(int fd);
 extern int Close(int fd);
 extern bool Unlink(char *name);
+extern char *MapFile(int fd, int length);
+extern void SyncMappedFile(char *addr, int length);
+extern void UnmapFile(char *addr, int length);
 
 // Other C library routines that are used by Nachos.
 // These are assumed to be portable, so we don't include a wrapper.
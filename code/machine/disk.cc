@@ -21,60 +21,122 @@
 
 // We put a magic number at the front of the UNIX file representing the
 // disk, to make it less likely we will accidentally treat a useful file 
-// as a disk (which would probably trash the file's contents).
+// as a disk (which would probably trash the file's contents).  After it
+// come the number of sectors per track and the number of tracks.
+//
+// Disks made before the geometry was recorded have a different magic
+// number, and nothing after it; they have the default geometry.
 
-const int MagicNumber = 0x456789ab;
+const int MagicNumber = 0x456789ac;
+const int OldMagicNumber = 0x456789ab;
 const int MagicSize = sizeof(int);
-const int DiskSize = (MagicSize + (NumSectors * SectorSize));
+const int HeaderSize = 3 * sizeof(int);
 
 
 //----------------------------------------------------------------------
 // Disk::Disk()
 // 	Initialize a simulated disk.  Open the UNIX file (creating it
 //	if it doesn't exist), and check the magic number to make sure it's 
-// 	ok to treat it as Nachos disk storage.
+// 	ok to treat it as Nachos disk storage.  If the file exists, its
+//	geometry is read from it; otherwise it is created with the
+//	geometry we are given.
+//
+//	If "mapped", map the file into memory, so that sector transfers
+//	don't need UNIX system calls.  If it can't be mapped, fall back
+//	on reading and writing it.
 //
+//	"name" -- the UNIX file holding the disk
+//	"numSectorsPerTrack", "numTracksPerDisk" -- geometry of a new disk
 //	"toCall" -- object to call when disk read/write request completes
+//	"mapped" -- should the file be mapped into memory?
 //----------------------------------------------------------------------
 
-Disk::Disk(CallBackObj *toCall)
+Disk::Disk(char *name, int numSectorsPerTrack, int numTracksPerDisk,
+		CallBackObj *toCall, bool mapped)
 {
     int magicNum;
     int tmp = 0;
 
-    DEBUG(dbgDisk, "Initializing the disk.");
+    DEBUG(dbgDisk, "Initializing the disk " << name);
     callWhenDone = toCall;
     lastSector = 0;
     bufferInit = 0;
+    statsID = kernel->stats->AddDisk();
     
-    sprintf(diskname,"DISK_%d",kernel->hostName);
+    ASSERT(strlen(name) < sizeof(diskname));
+    strcpy(diskname, name);
     fileno = OpenForReadWrite(diskname, FALSE);
     if (fileno >= 0) {		 	// file exists, check magic number 
 	Read(fileno, (char *) &magicNum, MagicSize);
-	ASSERT(magicNum == MagicNumber);
+	if (magicNum == OldMagicNumber) {
+	    sectorsPerTrack = DefaultSectorsPerTrack;
+	    numTracks = DefaultNumTracks;
+	    headerSize = MagicSize;
+	} else {
+	    ASSERT(magicNum == MagicNumber);
+	    Read(fileno, (char *) &sectorsPerTrack, sizeof(int));
+	    Read(fileno, (char *) &numTracks, sizeof(int));
+	    headerSize = HeaderSize;
+	}
+	diskSize = headerSize + NumSectors() * SectorSize;
     } else {				// file doesn't exist, create it
+	ASSERT(numSectorsPerTrack > 0 && numTracksPerDisk > 0);
+	sectorsPerTrack = numSectorsPerTrack;
+	numTracks = numTracksPerDisk;
+	headerSize = HeaderSize;
+	diskSize = headerSize + NumSectors() * SectorSize;
+
         fileno = OpenForWrite(diskname);
 	magicNum = MagicNumber;  
 	WriteFile(fileno, (char *) &magicNum, MagicSize); // write magic number
+	WriteFile(fileno, (char *) &sectorsPerTrack, sizeof(int));
+	WriteFile(fileno, (char *) &numTracks, sizeof(int));
 
 	// need to write at end of file, so that reads will not return EOF
-        Lseek(fileno, DiskSize - sizeof(int), 0);	
+        Lseek(fileno, diskSize - sizeof(int), 0);	
 	WriteFile(fileno, (char *)&tmp, sizeof(int));  
     }
+    DEBUG(dbgDisk, "Disk " << diskname << " has " << numTracks
+		<< " tracks of " << sectorsPerTrack << " sectors.");
+    image = NULL;
+    if (mapped) {
+	image = MapFile(fileno, diskSize);
+	if (image == NULL) {
+	    DEBUG(dbgDisk, "Can't map " << diskname << ", using read/write.");
+	}
+    }
     active = FALSE;
 }
 
 //----------------------------------------------------------------------
 // Disk::~Disk()
 // 	Clean up disk simulation, by closing the UNIX file representing the
-//	disk.
+//	disk (after writing back and unmapping it, if it is mapped).
 //----------------------------------------------------------------------
 
 Disk::~Disk()
 {
+    if (image != NULL) {
+	Sync();
+	UnmapFile(image, diskSize);
+    }
     Close(fileno);
 }
 
+//----------------------------------------------------------------------
+// Disk::Sync()
+// 	Force the changes made to a mapped disk out to the UNIX file.
+//	Reads and writes of an unmapped disk go straight to the file,
+//	so there is nothing to do.
+//----------------------------------------------------------------------
+
+void
+Disk::Sync()
+{
+    if (image != NULL)
+	SyncMappedFile(image, diskSize);
+}
+
 //----------------------------------------------------------------------
 // Disk::PrintSector()
 // 	Dump the data in a disk read/write request, for debugging.
@@ -98,7 +160,8 @@ PrintSector (bool writing, int sector, char *data)
 //----------------------------------------------------------------------
 // Disk::ReadRequest/WriteRequest
 // 	Simulate a request to read/write a single disk sector
-//	   Do the read/write immediately to the UNIX file
+//	   Do the read/write immediately to the UNIX file (or copy
+//	      to/from its image in memory, if it is mapped)
 //	   Set up an interrupt handler to be called later,
 //	      that will notify the caller when the simulator says
 //	      the operation has completed.
@@ -113,43 +176,101 @@ PrintSector (bool writing, int sector, char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, FALSE);
+    ReadRequest(sectorNumber, 1, data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, char* data)
+{
+    WriteRequest(sectorNumber, 1, data);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of consecutive sectors,
+//	as above.  There is one interrupt, when the last sector is done.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors to read/write
+//	"data" -- where the first sector's contents are in memory
+//	"stride" -- how far apart in memory the sectors are
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int numSectors, char* data, int stride)
+{
+    int ticks = ComputeLatency(sectorNumber, numSectors, FALSE);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors()));
     
-    DEBUG(dbgDisk, "Reading from sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(FALSE, sectorNumber, data);
+    DEBUG(dbgDisk, "Reading " << numSectors << " sectors from sector " << sectorNumber);
+    Transfer(FALSE, sectorNumber, numSectors, data, stride);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     kernel->stats->numDiskReads++;
+    if (kernel->currentThread->space != NULL)	// charge it to the program
+	kernel->currentThread->space->numDiskReads++;
+    kernel->stats->diskRequests[statsID]++;
+    kernel->stats->diskBusyTicks[statsID] += ticks;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, char* data)
+Disk::WriteRequest(int sectorNumber, int numSectors, char* data, int stride)
 {
-    int ticks = ComputeLatency(sectorNumber, TRUE);
+    int ticks = ComputeLatency(sectorNumber, numSectors, TRUE);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors()));
     
-    DEBUG(dbgDisk, "Writing to sector " << sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
-    if (debug->IsEnabled('d'))
-	PrintSector(TRUE, sectorNumber, data);
+    DEBUG(dbgDisk, "Writing " << numSectors << " sectors to sector " << sectorNumber);
+    Transfer(TRUE, sectorNumber, numSectors, data, stride);
     
     active = TRUE;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     kernel->stats->numDiskWrites++;
+    kernel->stats->diskRequests[statsID]++;
+    kernel->stats->diskBusyTicks[statsID] += ticks;
     kernel->interrupt->Schedule(this, ticks, DiskInt);
 }
 
+//----------------------------------------------------------------------
+// Disk::Transfer()
+// 	Copy the data for a request between memory and the UNIX file
+//	(or its image in memory).  The sectors are consecutive in the
+//	file, so one seek will do.
+//----------------------------------------------------------------------
+
+void
+Disk::Transfer(bool writing, int sectorNumber, int numSectors, char *data,
+			int stride)
+{
+    char *where, *buffer;
+
+    if (image == NULL)
+	Lseek(fileno, SectorSize * sectorNumber + headerSize, 0);
+    for (int i = 0; i < numSectors; i++) {
+	buffer = &data[i * stride];
+	if (image != NULL) {
+	    where = &image[SectorSize * (sectorNumber + i) + headerSize];
+	    if (writing)
+		bcopy(buffer, where, SectorSize);
+	    else
+		bcopy(where, buffer, SectorSize);
+	} else if (writing) {
+	    WriteFile(fileno, buffer, SectorSize);
+	} else {
+	    Read(fileno, buffer, SectorSize);
+	}
+	if (debug->IsEnabled('d'))
+	    PrintSector(writing, sectorNumber + i, buffer);
+    }
+}
+
 //----------------------------------------------------------------------
 // Disk::CallBack()
 // 	Called by the machine simulation when the disk interrupt occurs.
@@ -176,8 +297,8 @@ Disk::CallBack ()
 int
 Disk::TimeToSeek(int newSector, int *rotation) 
 {
-    int newTrack = newSector / SectorsPerTrack;
-    int oldTrack = lastSector / SectorsPerTrack;
+    int newTrack = newSector / sectorsPerTrack;
+    int oldTrack = lastSector / sectorsPerTrack;
     int seek = abs(newTrack - oldTrack) * SeekTime;
 				// how long will seek take?
     int over = (kernel->stats->totalTicks + seek) % RotationTime; 
@@ -199,10 +320,10 @@ Disk::TimeToSeek(int newSector, int *rotation)
 int 
 Disk::ModuloDiff(int to, int from)
 {
-    int toOffset = to % SectorsPerTrack;
-    int fromOffset = from % SectorsPerTrack;
+    int toOffset = to % sectorsPerTrack;
+    int fromOffset = from % sectorsPerTrack;
 
-    return ((toOffset - fromOffset) + SectorsPerTrack) % SectorsPerTrack;
+    return ((toOffset - fromOffset) + sectorsPerTrack) % sectorsPerTrack;
 }
 
 //----------------------------------------------------------------------
@@ -249,6 +370,24 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long it will take to read/write a run of "numSectors"
+//	sectors starting at "newSector".  We pay as above to get to the
+//	first sector; each sector after that takes RotationTime, and
+//	each time the run goes on to the next track, we seek one track.
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int numSectors, bool writing)
+{
+    int lastSector = newSector + numSectors - 1;
+    int tracks = lastSector / sectorsPerTrack - newSector / sectorsPerTrack;
+
+    return ComputeLatency(newSector, writing)
+		+ (numSectors - 1) * RotationTime + tracks * SeekTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
@@ -266,3 +405,23 @@ Disk::UpdateLast(int newSector)
     lastSector = newSector;
     DEBUG(dbgDisk, "Updating last sector = " << lastSector << " , " << bufferInit);
 }
+
+//----------------------------------------------------------------------
+// Disk::UpdateLast
+//   	Same, for a request for a run of "numSectors" sectors, which
+//	takes "ticks".  If the run ends on a different track than it
+//	started, the track buffer started loading when the head reached
+//	the start of the last track.
+//----------------------------------------------------------------------
+
+void
+Disk::UpdateLast(int newSector, int numSectors, int ticks)
+{
+    int last = newSector + numSectors - 1;
+
+    UpdateLast(newSector);
+    if (last / sectorsPerTrack != newSector / sectorsPerTrack)
+	bufferInit = kernel->stats->totalTicks + ticks
+			- ((last % sectorsPerTrack) + 1) * RotationTime;
+    lastSector = last;
+}
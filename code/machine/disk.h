@@ -27,13 +27,22 @@
 // sector has the same number of bytes of storage).  
 //
 // Addressing is by sector number -- each sector on the disk is given
-// a unique number: track * SectorsPerTrack + offset within a track.
+// a unique number: track * sectorsPerTrack + offset within a track.
+//
+// The number of tracks, and of sectors per track, is chosen when the
+// disk is first created, and recorded at the front of the UNIX file
+// next to its magic number; a disk that already exists keeps its
+// geometry.  There can be several disks, each in its own UNIX file.
 //
 // As with other I/O devices, the raw physical disk is an asynchronous device --
 // requests to read or write portions of the disk return immediately,
 // and an interrupt is invoked later to signal that the operation completed.
 //
 // The physical disk is in fact simulated via operations on a UNIX file.
+// Optionally, the file is mapped into memory instead, so that reading or
+// writing a sector is just a copy, rather than a UNIX system call; the
+// changes are forced out to the file by Sync, and when the disk is
+// deallocated.
 //
 // To make life a little more realistic, the simulated time for
 // each operation reflects a "track buffer" -- RAM to store the contents
@@ -45,19 +54,31 @@
 // quickly, because its contents are in the track buffer.  Most 
 // disks these days now come with a track buffer.
 //
+// A request can also cover a run of consecutive sectors, kept in memory
+// one after another, or every so many bytes apart (so that a striped
+// volume can give each disk its share of a buffer).  The run costs one seek and
+// rotational delay, to get to its first sector; after that, the sectors
+// stream past the head at one per RotationTime, with a one-track seek
+// wherever the run goes on to the next track.
+//
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
 
 const int SectorSize = 128;		// number of bytes per disk sector
-const int SectorsPerTrack  = 32;	// number of sectors per disk track 
-const int NumTracks = 32;		// number of tracks per disk
-const int NumSectors = (SectorsPerTrack * NumTracks);
-					// total # of sectors per disk
+const int DefaultSectorsPerTrack = 32;	// number of sectors per disk track,
+const int DefaultNumTracks = 32;	// and tracks per disk, of a new
+					// disk, unless told otherwise
 
 class Disk : public CallBackObj {
   public:
-    Disk(CallBackObj *toCall);          // Create a simulated disk.  
+    Disk(char *name, int numSectorsPerTrack, int numTracksPerDisk,
+		CallBackObj *toCall, bool mapped = FALSE);
+					// Create a simulated disk, kept in
+					// the UNIX file "name", with the
+					// given geometry if it is new.
 					// Invoke toCall->CallBack() 
 					// when each request completes.
+					// If "mapped", map the UNIX file
+					// into memory.
     ~Disk();				// Deallocate the disk.
     
     void ReadRequest(int sectorNumber, char* data);
@@ -67,26 +88,57 @@ class Disk : public CallBackObj {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, char* data);
 
+    void ReadRequest(int sectorNumber, int numSectors, char* data,
+			int stride = SectorSize);
+    void WriteRequest(int sectorNumber, int numSectors, char* data,
+			int stride = SectorSize);
+					// Read/write "numSectors" sectors,
+					// starting at "sectorNumber", 
+					// to/from "data", each sector
+					// "stride" bytes after the last,
+					// as a single request
+
     void CallBack();			// Invoked when disk request 
 					// finishes. In turn calls, callWhenDone.
 
+    void Sync();			// Make sure all writes so far are
+					// in the UNIX file
+
+    int NumSectors() { return sectorsPerTrack * numTracks; }
+					// Total # of sectors on the disk
+    int SectorsPerTrack() { return sectorsPerTrack; }
+    int NumTracks() { return numTracks; }
+
     int ComputeLatency(int newSector, bool writing);	
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int numSectors, bool writing);
+					// Same, for a run of sectors
 
   private:
     int fileno;				// UNIX file number for simulated disk 
     char diskname[32];			// name of simulated disk's file
+    char *image;			// the file, mapped into memory,
+					// or NULL if we use read/write
+    int sectorsPerTrack;		// number of sectors per disk track
+    int numTracks;			// number of tracks on the disk
+    int headerSize;			// bytes before sector 0 in the file
+    int diskSize;			// total bytes in the file
     CallBackObj *callWhenDone;		// Invoke when any disk request finishes
     bool active;     			// Is a disk operation in progress?
     int lastSector;			// The previous disk request 
     int bufferInit;			// When the track buffer started 
 					// being loaded
+    int statsID;			// Our index in kernel->stats
 
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void UpdateLast(int newSector, int numSectors, int ticks);
+    void Transfer(bool writing, int sectorNumber, int numSectors,
+		char *data, int stride);// Do a request's reads/writes 
+					// of the UNIX file
 };
 
 #endif // DISK_H
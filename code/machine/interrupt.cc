@@ -157,17 +157,20 @@ void Interrupt::OneTick()
 {
   MachineStatus oldStatus = status;
   Statistics *stats = kernel->stats;
+  Thread *thread = kernel->currentThread;
 
-  // advance simulated time
+  // advance simulated time, charging it to the running thread too
   if (status == SystemMode)
   {
     stats->totalTicks += SystemTick;
     stats->systemTicks += SystemTick;
+    thread->systemTicks += SystemTick;
   }
   else
   {
     stats->totalTicks += UserTick;
     stats->userTicks += UserTick;
+    thread->userTicks += UserTick;
   }
   DEBUG(dbgInt, "== Tick " << stats->totalTicks << " ==");
 
@@ -22,6 +22,39 @@ Statistics::Statistics()
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numDisks = 0;
+    for (int i = 0; i < MaxSyscallStats; i++) {
+	syscallNames[i] = NULL;
+	syscallCalls[i] = syscallTicks[i] = 0;
+    }
+}
+
+//----------------------------------------------------------------------
+// Statistics::AddDisk
+// 	Start keeping track of how busy a new disk is.  Return the
+//	disk's index in diskBusyTicks and diskRequests.
+//----------------------------------------------------------------------
+
+int
+Statistics::AddDisk()
+{
+    ASSERT(numDisks < MaxDiskStats);
+    diskBusyTicks[numDisks] = 0;
+    diskRequests[numDisks] = 0;
+    return numDisks++;
+}
+
+//----------------------------------------------------------------------
+// Statistics::AddSyscall
+// 	Start keeping track of how often the system call numbered
+//	"which" is made, and how long it takes, under "name".
+//----------------------------------------------------------------------
+
+void
+Statistics::AddSyscall(int which, const char *name)
+{
+    ASSERT(which >= 0 && which < MaxSyscallStats);
+    syscallNames[which] = name;
 }
 
 //----------------------------------------------------------------------
@@ -37,9 +70,25 @@ Statistics::Print()
 		cout << ", system " << systemTicks << ", user " << userTicks <<"\n";
     cout << "Disk I/O: reads " << numDiskReads;
 		cout << ", writes " << numDiskWrites << "\n";
+    if (numDisks > 1) {
+	for (int i = 0; i < numDisks; i++) {
+	    cout << "Disk " << i << ": requests " << diskRequests[i];
+	    cout << ", busy " << diskBusyTicks[i] << " ticks";
+	    if (totalTicks > 0)
+		cout << " (" << (100.0 * diskBusyTicks[i] / totalTicks) << "%)";
+	    cout << "\n";
+	}
+    }
 		cout << "Console I/O: reads " << numConsoleCharsRead;
     cout << ", writes " << numConsoleCharsWritten << "\n";
     cout << "Paging: faults " << numPageFaults << "\n";
     cout << "Network I/O: packets received " << numPacketsRecvd;
 		cout << ", sent " << numPacketsSent << "\n";
+    for (int i = 0; i < MaxSyscallStats; i++) {
+	if (syscallCalls[i] == 0)
+	    continue;
+	cout << "Syscall " << (syscallNames[i] ? syscallNames[i] : "?");
+	cout << ": calls " << syscallCalls[i];
+	cout << ", ticks " << syscallTicks[i] << "\n";
+    }
 }
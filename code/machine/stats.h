@@ -18,6 +18,16 @@
 // many user instructions executed, etc.
 //
 // The fields in this class are public to make it easier to update.
+//
+// Each simulated disk also registers itself, so we can report how
+// busy each one was -- with several disks, requests to different
+// disks overlap in time.
+//
+// Each system call is counted too, along with the time spent in it,
+// under the call's number.
+
+const int MaxDiskStats = 16;	// most disks we keep track of
+const int MaxSyscallStats = 128; // highest system call number, plus one
 
 class Statistics {
   public:
@@ -36,8 +46,23 @@ class Statistics {
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
+    int numDisks;		// number of disks registered
+    int diskBusyTicks[MaxDiskStats];	// time each disk spent
+				// handling requests
+    int diskRequests[MaxDiskStats];	// requests each disk handled
+
+    const char *syscallNames[MaxSyscallStats];	// name of each system
+				// call, if it has been registered
+    int syscallCalls[MaxSyscallStats];	// times each was called
+    int syscallTicks[MaxSyscallStats];	// time spent in each
+
     Statistics(); 		// initialize everything to zero
 
+    int AddDisk();		// register a disk, returning its index
+				// into diskBusyTicks and diskRequests
+    void AddSyscall(int which, const char *name);
+				// register system call number "which"
+
     void Print();		// print collected statistics
 };
 
@@ -0,0 +1,21 @@
+#include "syscall.h"
+
+/* Run before futex_wake ("nachos -e futex_wait -e futex_wake"): sleep,
+ * without spinning, until futex_wake sets the flag in the shared
+ * segment "flag".
+ */
+
+int main(void)
+{
+	int *flag;
+
+	ShmCreate("flag", sizeof(int));		/* unless futex_wake did */
+	flag = (int *) ShmAttach("flag");
+	if (flag == (int *) -1) MSG("Failed on attaching segment");
+
+	while (*flag == 0)
+		if (FutexWait(flag, 0) == -1) MSG("Failed on waiting");
+	PrintInt(*flag);
+	MSG("Success on waiting for the flag");
+	Halt();
+}
@@ -0,0 +1,19 @@
+#include "syscall.h"
+
+/* Run with futex_wait: set the flag in the shared segment "flag",
+ * and wake whoever is waiting for it.
+ */
+
+int main(void)
+{
+	int *flag;
+
+	ShmCreate("flag", sizeof(int));		/* unless futex_wait did */
+	flag = (int *) ShmAttach("flag");
+	if (flag == (int *) -1) MSG("Failed on attaching segment");
+
+	*flag = 42;
+	if (FutexWake(flag, 1) == -1) MSG("Failed on waking");
+	ShmDetach(flag);
+	Exit(0);
+}
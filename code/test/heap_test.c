@@ -0,0 +1,49 @@
+#include "syscall.h"
+#include "umalloc.h"
+
+/* Sort arrays sized at run time, kept on the heap, instead of sizing
+ * a static array for the worst case.
+ */
+
+int *MakeArray(int n)
+{
+	int *a = (int *) malloc(n * sizeof(int));
+	int i;
+
+	if (a == 0) MSG("Failed on allocating memory");
+	for (i = 0; i < n; i++)
+		a[i] = n - i;
+	return a;
+}
+
+void Sort(int *a, int n)
+{
+	int i, j, tmp;
+
+	for (i = 0; i < n - 1; i++)
+		for (j = 0; j < n - 1 - i; j++)
+			if (a[j] > a[j + 1]) {
+				tmp = a[j];
+				a[j] = a[j + 1];
+				a[j + 1] = tmp;
+			}
+}
+
+int main(void)
+{
+	int *a, *b, *c;
+
+	a = MakeArray(100);
+	b = MakeArray(10);
+	Sort(a, 100);
+	PrintInt(a[0]);
+	free(a);
+	c = MakeArray(50);		/* reuses what a gave back */
+	if (c < a || c >= a + 100) MSG("Failed on reusing memory");
+	Sort(c, 50);
+	PrintInt(c[49]);
+	free(b);
+	free(c);
+	MSG("Success on using the heap");
+	Halt();
+}
@@ -0,0 +1,35 @@
+#include "syscall.h"
+
+/* Map a file, read and change it through memory, and check that the
+ * change went back to the file.
+ */
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz";
+	char buffer[26];
+	char *p;
+	OpenFileId fid;
+	int i;
+
+	if (Create("file3.test") != 1) MSG("Failed on creating file");
+	fid = Open("file3.test");
+	if (Write(test, 26, fid) != 26) MSG("Failed on writing file");
+	Close(fid);
+
+	p = (char *) Mmap("file3.test");
+	if (p == (char *) -1) MSG("Failed on mapping file");
+	for (i = 0; i < 26; i++)
+		if (p[i] != test[i]) MSG("Failed on reading mapped file");
+	for (i = 0; i < 26; i++)
+		p[i] = test[i] - 'a' + 'A';	/* capitalize it in place */
+	if (Munmap(p) != 1) MSG("Failed on unmapping file");
+
+	fid = Open("file3.test");
+	if (Read(buffer, 26, fid) != 26) MSG("Failed on reading file");
+	for (i = 0; i < 26; i++)
+		if (buffer[i] != test[i] - 'a' + 'A') MSG("Failed on writing back file");
+	Close(fid);
+	MSG("Success on mapping file3.test");
+	Halt();
+}
@@ -0,0 +1,43 @@
+#include "syscall.h"
+
+/* Time two phases of work -- computing, then writing a file -- with
+ * the performance counters, and print what each cost.
+ */
+
+int data[256];
+
+void Report(PerfCounters *before, PerfCounters *after)
+{
+	PrintInt(after->totalTicks - before->totalTicks);
+	PrintInt(after->userTicks - before->userTicks);
+	PrintInt(after->systemTicks - before->systemTicks);
+	PrintInt(after->syscalls - before->syscalls);
+}
+
+int main(void)
+{
+	PerfCounters start, middle, end;
+	OpenFileId fid;
+	int i, j;
+
+	if (GetPerfCounters(&start) != 1) MSG("Failed on reading counters");
+	for (i = 0; i < 256; i++)
+		for (j = 0; j < 10; j++)
+			data[i] += i * j;
+	GetPerfCounters(&middle);
+
+	if (Create("file4.test") != 1) MSG("Failed on creating file");
+	fid = Open("file4.test");
+	for (i = 0; i < 16; i++)
+		Write((char *) &data[i * 16], 16 * sizeof(int), fid);
+	Close(fid);
+	GetPerfCounters(&end);
+
+	if (middle.userTicks <= start.userTicks) MSG("Failed on counting user time");
+	if (end.syscalls - middle.syscalls != 20) MSG("Failed on counting calls");
+	if (GetTicks() < end.totalTicks) MSG("Failed on reading the clock");
+	Report(&start, &middle);
+	Report(&middle, &end);
+	MSG("Success on counting");
+	Halt();
+}
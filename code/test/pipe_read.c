@@ -0,0 +1,24 @@
+#include "syscall.h"
+
+/* Run with pipe_write: read the alphabet from the pipe "letters",
+ * taking whatever has arrived each time, and print it.
+ */
+
+int main(void)
+{
+	char buffer[27];
+	OpenFileId fds[2];
+	int n, got;
+
+	if (Pipe("letters", fds) != 1) MSG("Failed on opening pipe");
+	for (got = 0; got < 26; got += n) {
+		n = Read(buffer + got, 26 - got, fds[0]);
+		if (n <= 0) MSG("Failed on reading pipe");
+	}
+	buffer[26] = '\0';
+	Write(buffer, 26, SysConsoleOutput);
+	Close(fds[0]);
+	Close(fds[1]);
+	MSG("Success on reading the pipe");
+	Halt();
+}
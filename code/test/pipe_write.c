@@ -0,0 +1,18 @@
+#include "syscall.h"
+
+/* Run with pipe_read ("nachos -e pipe_write -e pipe_read"): send the
+ * alphabet through the pipe "letters", in two writes.
+ */
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz";
+	OpenFileId fds[2];
+
+	if (Pipe("letters", fds) != 1) MSG("Failed on opening pipe");
+	if (Write(test, 13, fds[1]) != 13) MSG("Failed on writing pipe");
+	if (Write(test + 13, 13, fds[1]) != 13) MSG("Failed on writing pipe");
+	Close(fds[0]);
+	Close(fds[1]);
+	Exit(0);
+}
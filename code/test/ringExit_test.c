@@ -0,0 +1,35 @@
+#include "syscall.h"
+
+/* Run with ringExit_wait ("nachos -e ringExit_test -e ringExit_wait"):
+ * exit while the syscall ring is blocked reading an empty pipe whose
+ * only write end is our own, and is still open.  Exit must close our
+ * descriptors and stop the ring anyway; ringExit_wait sees our end of
+ * the pipe "exited" close once it has.
+ */
+
+SyscallRing ring;
+
+int main(void)
+{
+	OpenFileId stuck[2], exited[2];
+	char buffer[1];
+	RingSubmission *entry;
+
+	if (Pipe("stuck", stuck) != 1) MSG("Failed on opening pipe");
+	if (Pipe("exited", exited) != 1) MSG("Failed on opening pipe");
+	if (RingSetup(&ring) != 1) MSG("Failed on setting up the ring");
+
+	/* tell ringExit_wait we have "exited" open */
+	if (Write("x", 1, exited[1]) != 1) MSG("Failed on writing pipe");
+
+	entry = &ring.submissions[ring.submitTail % RingEntries];
+	entry->type = SC_Read;
+	entry->arg1 = (int)buffer;
+	entry->arg2 = 1;
+	entry->arg3 = stuck[0];
+	entry->userData = 0;
+	ring.submitTail++;
+	RingEnter(0);	/* don't wait for it: it never completes */
+
+	Exit(0);
+}
@@ -0,0 +1,20 @@
+#include "syscall.h"
+
+/* Run with ringExit_test: wait for it to open the pipe "exited", then
+ * for every write end of it to be closed -- which happens only once
+ * ringExit_test has exited, with its ring still blocked on a pipe.
+ */
+
+int main(void)
+{
+	char buffer[1];
+	OpenFileId fds[2];
+
+	if (Pipe("exited", fds) != 1) MSG("Failed on opening pipe");
+	if (Read(buffer, 1, fds[0]) != 1) MSG("Failed on reading pipe");
+	Close(fds[1]);
+	if (Read(buffer, 1, fds[0]) != 0) MSG("Failed on reading end of file");
+	Close(fds[0]);
+	MSG("Success on exiting with the ring blocked");
+	Halt();
+}
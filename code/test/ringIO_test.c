@@ -0,0 +1,56 @@
+#include "syscall.h"
+
+SyscallRing ring;
+
+/* Submit one call to the ring; the caller must make sure there is room */
+void Submit(int type, int arg1, int arg2, int arg3, int userData)
+{
+	RingSubmission *entry = &ring.submissions[ring.submitTail % RingEntries];
+
+	entry->type = type;
+	entry->arg1 = arg1;
+	entry->arg2 = arg2;
+	entry->arg3 = arg3;
+	entry->userData = userData;
+	ring.submitTail++;
+}
+
+/* Wait for the oldest outstanding call, and return its result */
+int Reap(int *userData)
+{
+	RingCompletion *entry;
+
+	if (ring.completeHead == ring.completeTail)
+		RingEnter(1);
+	entry = &ring.completions[ring.completeHead % RingEntries];
+	*userData = entry->userData;
+	ring.completeHead++;
+	return entry->result;
+}
+
+int main(void)
+{
+	char test[] = "abcdefghijklmnopqrstuvwxyz";
+	OpenFileId fid;
+	int i, n, tag;
+
+	if (Create("file2.test") != 1) MSG("Failed on creating file");
+	fid = Open("file2.test");
+	if (fid < 0) MSG("Failed on opening file");
+	if (RingSetup(&ring) != 1) MSG("Failed on setting up the ring");
+
+	/* one byte per write, as fileIO_test1 does, but a batch per trap */
+	for (i = 0; i < 26; i += n) {
+		for (n = 0; n < RingEntries / 2 && i + n < 26; n++)
+			Submit(SC_Write, (int)(test + i + n), 1, fid, i + n);
+		RingEnter(n);
+		while (ring.completeHead != ring.completeTail)
+			if (Reap(&tag) != 1) MSG("Failed on writing file");
+	}
+
+	Submit(SC_Close, fid, 0, 0, -1);
+	RingEnter(1);
+	if (Reap(&tag) != 1 || tag != -1) MSG("Failed on closing file");
+	MSG("Success on creating file2.test");
+	Halt();
+}
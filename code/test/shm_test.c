@@ -0,0 +1,31 @@
+#include "syscall.h"
+
+/* Attach one shared memory segment twice: both mappings are the same
+ * memory, as they would be in two programs that attached it.
+ */
+
+int main(void)
+{
+	int *a, *b;
+	int i;
+
+	if (ShmCreate("counts", 400) != 1) MSG("Failed on creating segment");
+	a = (int *) ShmAttach("counts");
+	b = (int *) ShmAttach("counts");
+	if (a == (int *) -1 || b == (int *) -1) MSG("Failed on attaching segment");
+	if (a == b) MSG("Failed on mapping segment twice");
+
+	for (i = 0; i < 100; i++)
+		if (b[i] != 0) MSG("Failed on zeroing segment");
+	for (i = 0; i < 100; i++)
+		a[i] = i * i;
+	for (i = 0; i < 100; i++)
+		if (b[i] != i * i) MSG("Failed on sharing segment");
+
+	if (ShmDetach(a) != 1) MSG("Failed on detaching segment");
+	if (ShmDetach(a) != -1) MSG("Failed on detaching segment twice");
+	if (b[99] != 99 * 99) MSG("Failed on keeping segment");
+	ShmDetach(b);
+	MSG("Success on sharing memory");
+	Halt();
+}
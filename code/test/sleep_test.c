@@ -0,0 +1,17 @@
+#include "syscall.h"
+
+/* A periodic job: do a little work every 1000 ticks, sleeping in
+ * between instead of spinning.
+ */
+
+int main(void)
+{
+	int i;
+
+	for (i = 1; i <= 5; i++) {
+		Sleep(1000);
+		PrintInt(i);
+	}
+	MSG("Success on sleeping");
+	Halt();
+}
@@ -0,0 +1,99 @@
+/* umalloc.c
+ *	A memory allocator for user programs, built on the Sbrk system
+ *	call.
+ *
+ *	Each block of memory starts with a header giving its size.  Free
+ *	blocks are kept on a list sorted by address, so that a block
+ *	being freed can be merged with free neighbours.  malloc takes
+ *	the first free block big enough, splitting off what it doesn't
+ *	need; if none is, the heap is grown by at least MinGrow bytes, so
+ *	that small requests don't each cost a system call.
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation 
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#include "syscall.h"
+#include "umalloc.h"
+
+typedef struct Block {
+    int size;			/* bytes in the block, with this header */
+    struct Block *next;		/* next free block, if this one is free */
+} Block;
+
+#define Align 8			/* blocks are a multiple of this size */
+#define MinGrow 512		/* least to grow the heap by */
+
+#define RoundUp(n)	(((n) + Align - 1) & ~(Align - 1))
+#define HeaderSize	RoundUp(sizeof(Block))
+
+static Block *freeList = 0;	/* free blocks, by address */
+
+/* Grow the heap by enough for a block of "need" bytes, and put the
+ * new memory on the free list.  Return 0 if there is no memory left.
+ */
+static int Grow(int need)
+{
+    int amount = (need < MinGrow) ? MinGrow : need;
+    Block *b = (Block *) Sbrk(amount);
+
+    if (b == (Block *) -1)
+	return 0;
+    b->size = amount;
+    free((char *) b + HeaderSize);
+    return 1;
+}
+
+void *malloc(int size)
+{
+    Block **prev, *b;
+    int need;
+
+    if (size <= 0)
+	return 0;
+    need = RoundUp(size) + HeaderSize;
+    for (;;) {
+	for (prev = &freeList; (b = *prev) != 0; prev = &b->next) {
+	    if (b->size < need)
+		continue;
+	    if (b->size - need >= HeaderSize + Align) {
+		/* give out the end of the block, keep the rest free */
+		b->size -= need;
+		b = (Block *) ((char *) b + b->size);
+		b->size = need;
+	    } else {
+		*prev = b->next;
+	    }
+	    return (char *) b + HeaderSize;
+	}
+	if (!Grow(need))
+	    return 0;
+    }
+}
+
+void free(void *p)
+{
+    Block *b, *prev = 0, *next;
+
+    if (p == 0)
+	return;
+    b = (Block *) ((char *) p - HeaderSize);
+    for (next = freeList; next != 0 && next < b; next = next->next)
+	prev = next;
+
+    /* merge with the next block, then the previous one, if adjacent */
+    b->next = next;
+    if (next != 0 && (char *) b + b->size == (char *) next) {
+	b->size += next->size;
+	b->next = next->next;
+    }
+    if (prev == 0) {
+	freeList = b;
+    } else if ((char *) prev + prev->size == (char *) b) {
+	prev->size += b->size;
+	prev->next = b->next;
+    } else {
+	prev->next = b;
+    }
+}
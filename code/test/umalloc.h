@@ -0,0 +1,19 @@
+/* umalloc.h
+ *	A memory allocator for user programs, built on the Sbrk system
+ *	call.  Link umalloc.o with the program (see the Makefile).
+ *
+ * Copyright (c) 1992-1993 The Regents of the University of California.
+ * All rights reserved.  See copyright.h for copyright notice and limitation 
+ * of liability and disclaimer of warranty provisions.
+ */
+
+#ifndef UMALLOC_H
+#define UMALLOC_H
+
+/* Return "size" bytes of memory, or 0 if there is none left */
+void *malloc(int size);
+
+/* Give back memory returned by malloc */
+void free(void *p);
+
+#endif /* UMALLOC_H */
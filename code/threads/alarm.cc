@@ -1,8 +1,7 @@
 // alarm.cc
 //	Routines to use a hardware timer device to provide a
-//	software alarm clock.  For now, we just provide time-slicing.
-//
-//	Not completely implemented.
+//	software alarm clock: time-slicing, and threads sleeping
+//	until a given time.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -23,6 +22,96 @@
 Alarm::Alarm(bool doRandom)
 {
     timer = new Timer(doRandom, this);
+    maxSleepers = 16;
+    sleepers = new Sleeper[maxSleepers];
+    numSleepers = 0;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+//      Turn off the alarm clock.  Threads still sleeping are never
+//	woken up.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    delete timer;
+    delete [] sleepers;
+}
+
+//----------------------------------------------------------------------
+// Alarm::Push
+// Alarm::Pop
+//	Add a sleeping thread to the heap, or take off the one that is
+//	to wake up first.  The children of sleepers[i] are
+//	sleepers[2i+1] and sleepers[2i+2], and neither wakes up before
+//	it does.  The heap doubles in size when it fills up.
+//----------------------------------------------------------------------
+
+void
+Alarm::Push(Sleeper sleeper)
+{
+    int i, parent;
+
+    if (numSleepers == maxSleepers) {
+	Sleeper *bigger = new Sleeper[maxSleepers * 2];
+
+	for (i = 0; i < numSleepers; i++)
+	    bigger[i] = sleepers[i];
+	delete [] sleepers;
+	sleepers = bigger;
+	maxSleepers *= 2;
+    }
+
+    // move parents down until there's a place for the new one
+    for (i = numSleepers++; i > 0; i = parent) {
+	parent = (i - 1) / 2;
+	if (sleepers[parent].wakeTime <= sleeper.wakeTime)
+	    break;
+	sleepers[i] = sleepers[parent];
+    }
+    sleepers[i] = sleeper;
+}
+
+Sleeper
+Alarm::Pop()
+{
+    Sleeper first = sleepers[0];
+    Sleeper last = sleepers[--numSleepers];
+    int i, child;
+
+    // move the last one down from the top, past earlier children
+    for (i = 0; (child = 2 * i + 1) < numSleepers; i = child) {
+	if (child + 1 < numSleepers
+		&& sleepers[child + 1].wakeTime < sleepers[child].wakeTime)
+	    child++;
+	if (last.wakeTime <= sleepers[child].wakeTime)
+	    break;
+	sleepers[i] = sleepers[child];
+    }
+    sleepers[i] = last;
+    return first;
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+//	Put the current thread to sleep until "x" ticks from now have
+//	gone by.  It is woken up by the first timer interrupt after that.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int x)
+{
+    IntStatus oldLevel = kernel->interrupt->SetLevel(IntOff);
+    Sleeper sleeper;
+
+    sleeper.wakeTime = kernel->stats->totalTicks + x;
+    sleeper.thread = kernel->currentThread;
+    DEBUG(dbgThread, "Sleeping until " << sleeper.wakeTime << ": "
+				<< sleeper.thread->getName());
+    Push(sleeper);
+    kernel->currentThread->Sleep(FALSE);
+    (void) kernel->interrupt->SetLevel(oldLevel);
 }
 
 //----------------------------------------------------------------------
@@ -39,8 +128,9 @@ Alarm::Alarm(bool doRandom)
 //	if the interrupted thread called Yield at the point it is 
 //	was interrupted.
 //
-//	For now, just provide time-slicing.  Only need to time slice 
-//      if we're currently running something (in other words, not idle).
+//	First wake up the threads whose time is up.  Then time-slice;
+//	only need to time slice if we're currently running something
+//	(in other words, not idle).
 //----------------------------------------------------------------------
 
 void 
@@ -48,6 +138,14 @@ Alarm::CallBack()
 {
     Interrupt *interrupt = kernel->interrupt;
     MachineStatus status = interrupt->getStatus();
+
+    while (numSleepers > 0
+		&& sleepers[0].wakeTime <= kernel->stats->totalTicks) {
+	Sleeper sleeper = Pop();
+
+	DEBUG(dbgThread, "Waking up " << sleeper.thread->getName());
+	kernel->scheduler->ReadyToRun(sleeper.thread);
+    }
     
     if (status != IdleMode) {
 	interrupt->YieldOnReturn();
@@ -8,7 +8,11 @@
 //	From this, we provide the ability for a thread to be
 //	woken up after a delay; we also provide time-slicing.
 //
-//	NOTE: this abstraction is not completely implemented.
+//	Sleeping threads are kept in a heap ordered by when they are to
+//	wake up, so that each timer interrupt finds the ones that are due
+//	by looking at the top of the heap, and putting a thread to sleep
+//	or waking it up takes O(log n) time.  Threads wake up at the
+//	first timer interrupt after their time is up.
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -22,18 +26,33 @@
 #include "callback.h"
 #include "timer.h"
 
+class Thread;
+
+// The following class defines a thread waiting for the alarm clock.
+class Sleeper {
+  public:
+    int wakeTime;		// when to wake it up, in ticks
+    Thread *thread;		// the thread that is sleeping
+};
+
 // The following class defines a software alarm clock. 
 class Alarm : public CallBackObj {
   public:
     Alarm(bool doRandomYield);	// Initialize the timer, and callback 
 				// to "toCall" every time slice.
-    ~Alarm() { delete timer; }
+    ~Alarm();
     
     void WaitUntil(int x);	// suspend execution until time > now + x
-                                // this method is not yet implemented
 
   private:
     Timer *timer;		// the hardware timer device
+    Sleeper *sleepers;		// sleeping threads: a heap, earliest
+				// wakeTime first
+    int numSleepers;		// how many there are
+    int maxSleepers;		// how many "sleepers" has room for
+
+    void Push(Sleeper sleeper);	// add a thread to the heap
+    Sleeper Pop();		// take off the earliest one
 
     void CallBack();		// called when the hardware
 				// timer generates an interrupt
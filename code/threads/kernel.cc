@@ -15,8 +15,13 @@
 #include "libtest.h"
 #include "string.h"
 #include "synchdisk.h"
+#include "filetable.h"
 #include "post.h"
 #include "synchconsole.h"
+#include "pipe.h"
+#include "shm.h"
+#include "futex.h"
+#include "bitmap.h"
 
 //----------------------------------------------------------------------
 // Kernel::Kernel
@@ -33,6 +38,11 @@ Kernel::Kernel(int argc, char **argv)
 #ifndef FILESYS_STUB
     formatFlag = FALSE;
 #endif
+    mapDisk = FALSE;
+    numDisks = 1;
+    diskSectorsPerTrack = DefaultSectorsPerTrack;
+    diskNumTracks = DefaultNumTracks;
+    raidLevel = -1;
     reliability = 1;            // network reliability, default is 1.0
     hostName = 0;               // machine id, also UNIX socket name
                                 // 0 is the default machine id
@@ -60,6 +70,23 @@ Kernel::Kernel(int argc, char **argv)
 		} else if (strcmp(argv[i], "-f") == 0) {
 	    	formatFlag = TRUE;
 #endif
+		} else if (strcmp(argv[i], "-dm") == 0) {
+	    	mapDisk = TRUE;
+		} else if (strcmp(argv[i], "-dg") == 0) {
+	    	ASSERT(i + 2 < argc);
+	    	diskSectorsPerTrack = atoi(argv[i + 1]);
+	    	diskNumTracks = atoi(argv[i + 2]);
+	    	i += 2;
+		} else if (strcmp(argv[i], "-nd") == 0) {
+	    	ASSERT(i + 1 < argc);
+	    	numDisks = atoi(argv[i + 1]);
+	    	ASSERT(numDisks >= 1 && numDisks <= MaxDisks);
+	    	i++;
+		} else if (strcmp(argv[i], "-raid") == 0) {
+	    	ASSERT(i + 1 < argc);
+	    	raidLevel = atoi(argv[i + 1]);
+	    	ASSERT(raidLevel == 0 || raidLevel == 1);
+	    	i++;
         } else if (strcmp(argv[i], "-n") == 0) {
             ASSERT(i + 1 < argc);   // next argument is float
             reliability = atof(argv[i + 1]);
@@ -75,6 +102,8 @@ Kernel::Kernel(int argc, char **argv)
 #ifndef FILESYS_STUB
 	    	cout << "Partial usage: nachos [-nf]\n";
 #endif
+	    	cout << "Partial usage: nachos [-dm] [-dg sectorsPerTrack tracks] [-nd #]\n";
+	    	cout << "Partial usage: nachos [-raid 0|1]\n";
             cout << "Partial usage: nachos [-n #] [-m #]\n";
 		}
     }
@@ -103,14 +132,35 @@ Kernel::Initialize()
     scheduler = new Scheduler();	// initialize the ready queue
     alarm = new Alarm(randomSlice);	// start up time slicing
     machine = new Machine(debugUserProg);
+    frameMap = new Bitmap(NumPhysPages); // all of memory is free
     synchConsoleIn = new SynchConsoleInput(consoleIn); // input from stdin
     synchConsoleOut = new SynchConsoleOutput(consoleOut); // output to stdout
-    synchDisk = new SynchDisk();    //
+    for (int i = 0; i < numDisks; i++) {
+	char diskName[32];
+
+	// the first disk keeps its old name, DISK_<host id>
+	if (i == 0)
+	    sprintf(diskName, "DISK_%d", hostName);
+	else
+	    sprintf(diskName, "DISK_%d.%d", hostName, i);
+	disks[i] = new SynchDisk(diskName, diskSectorsPerTrack,
+					diskNumTracks, mapDisk);
+    }
+    if (raidLevel == 0)
+	synchDisk = new SynchDisk(disks, numDisks, Striped);
+    else if (raidLevel == 1)
+	synchDisk = new SynchDisk(disks, numDisks, Mirrored);
+    else
+	synchDisk = disks[0];
 #ifdef FILESYS_STUB
     fileSystem = new FileSystem();
 #else
+    openFileTable = new OpenFileTable();
     fileSystem = new FileSystem(formatFlag);
 #endif // FILESYS_STUB
+    pipeTable = new PipeTable();
+    sharedMemory = new SharedMemoryTable();
+    futexes = new FutexTable();
     postOfficeIn = new PostOfficeInput(10);
     postOfficeOut = new PostOfficeOutput(reliability);
 
@@ -128,11 +178,21 @@ Kernel::~Kernel()
     delete interrupt;
     delete scheduler;
     delete alarm;
+    delete futexes;
+    delete sharedMemory;
+    delete frameMap;
     delete machine;
     delete synchConsoleIn;
     delete synchConsoleOut;
-    delete synchDisk;
     delete fileSystem;
+#ifndef FILESYS_STUB
+    delete openFileTable;
+#endif
+    delete pipeTable;
+    if (synchDisk != disks[0])
+	delete synchDisk;		// a volume, on top of the disks
+    for (int i = 0; i < numDisks; i++)
+	delete disks[i];
     delete postOfficeIn;
     delete postOfficeOut;
     
@@ -148,6 +208,7 @@ void
 Kernel::ThreadSelfTest() {
    Semaphore *semaphore;
    SynchList<int> *synchList;
+   RWLock *rwLock;
    
    LibSelfTest();		// test library routines
    
@@ -164,6 +225,11 @@ Kernel::ThreadSelfTest() {
    synchList->SelfTest(9);
    delete synchList;
 
+   				// test reader-writer locks
+   rwLock = new RWLock("test");
+   rwLock->SelfTest();
+   delete rwLock;
+
 }
 
 //----------------------------------------------------------------------
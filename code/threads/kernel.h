@@ -24,9 +24,16 @@ class PostOfficeOutput;
 class SynchConsoleInput;
 class SynchConsoleOutput;
 class SynchDisk;
+class OpenFileTable;
+class PipeTable;
+class SharedMemoryTable;
+class FutexTable;
+class Bitmap;
 
 typedef int OpenFileId;
 
+const int MaxDisks = 8; // most simulated disks we can attach
+
 class Kernel
 {
 public:
@@ -44,6 +51,8 @@ public:
   void ConsoleTest(); // interactive console self test
   void NetworkTest(); // interactive 2-machine network test
   Thread *getThread(int threadID) { return t[threadID]; }
+  SynchDisk *getDisk(int diskID) { return disks[diskID]; }
+  int getNumDisks() { return numDisks; }
 
   void PrintInt(int number);
   int CreateFile(char *filename); // fileSystem call
@@ -62,10 +71,20 @@ public:
   Statistics *stats;     // performance metrics
   Alarm *alarm;          // the software alarm clock
   Machine *machine;      // the simulated CPU
+  Bitmap *frameMap;      // which physical pages are in use
   SynchConsoleInput *synchConsoleIn;
   SynchConsoleOutput *synchConsoleOut;
-  SynchDisk *synchDisk;
+  SynchDisk *synchDisk; // the disk holding the file system
+                        // (getDisk(0), or a volume made of
+                        // all the disks)
   FileSystem *fileSystem;
+#ifndef FILESYS_STUB
+  OpenFileTable *openFileTable; // every file that is open, with
+                                // its shared header
+#endif
+  PipeTable *pipeTable; // pipes between user programs, by name
+  SharedMemoryTable *sharedMemory; // shared memory segments, by name
+  FutexTable *futexes;  // threads waiting on words in user memory
   PostOfficeInput *postOfficeIn;
   PostOfficeOutput *postOfficeOut;
 
@@ -73,6 +92,12 @@ public:
 
 private:
   Thread *t[10];
+  SynchDisk *disks[MaxDisks]; // all the simulated disks
+  int numDisks;               // how many there are
+  int diskSectorsPerTrack;    // geometry of newly created disks
+  int diskNumTracks;
+  int raidLevel;              // 0 to stripe the file system across
+                              // the disks, 1 to mirror it, or -1
   char *execfile[10];
   int execfileNum;
   int threadNum;
@@ -84,6 +109,7 @@ private:
 #ifndef FILESYS_STUB
   bool formatFlag; // format the disk if this is true
 #endif
+  bool mapDisk; // map the disk's UNIX file into memory
 };
 
 #endif // KERNEL_H
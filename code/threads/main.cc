@@ -6,7 +6,11 @@
 //              -s -x <nachos file> -ci <consoleIn> -co <consoleOut>
 //              -f -cp <unix file> <nachos file>
 //              -p <nachos file> -r <nachos file> -l -D
-//              -n <network reliability> -m <machine id>
+//              -mkdir <nachos dir> -lr <nachos dir>
+//              -import <list file> -export <list file>
+//              -n <network reliability> -m <machine id> -dm
+//              -dg <sectors per track> <tracks> -nd <number of disks>
+//              -raid <0 or 1>
 //              -z -K -C -N
 //
 //    -d causes certain debugging messages to be printed (see debug.h)
@@ -18,6 +22,12 @@
 //    -co specify file for console output (stdout is the default)
 //    -n sets the network reliability
 //    -m sets this machine's host id (needed for the network)
+//    -dm maps the simulated disk's UNIX file into memory
+//    -dg sets the geometry of newly created simulated disks
+//    -nd sets the number of simulated disks (DISK_<id>, DISK_<id>.1, ...);
+//        the file system is kept on the first
+//    -raid keeps the file system on all the disks instead, striped
+//        across them (0) or mirrored on each of them (1)
 //    -K run a simple self test of kernel threads and synchronization
 //    -C run an interactive console test
 //    -N run a two-machine network test (see Kernel::NetworkTest)
@@ -27,8 +37,14 @@
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -l lists the contents of the Nachos root directory
+//    -mkdir creates a Nachos directory
+//    -lr recursively lists the contents of a Nachos directory
 //    -D prints the contents of the entire file system 
+//    -import copies many files from UNIX to Nachos at once; the list
+//        file holds pairs of names, "<unix file> <nachos file>"
+//    -export copies many files from Nachos to UNIX; the list file
+//        holds pairs of names, "<nachos file> <unix file>"
 //
 //  Note: the file system flags are not used if the stub filesystem
 //        is being used
@@ -63,15 +79,104 @@ Cleanup(int x)
     delete kernel; 
 }
 
-//-------------------------------------------------------------------
-// Constant used by "Copy" and "Print"
-//   It is the number of bytes read from the Unix file (for Copy)
-//   or the Nachos file (for Print) by each read operation
-//-------------------------------------------------------------------
-static const int TransferSize = 128;
+#ifndef FILESYS_STUB
+//----------------------------------------------------------------------
+// UnixFileLength
+//      Return the length of the UNIX file "name", or -1 if it can't
+//	be opened.
+//----------------------------------------------------------------------
 
+static int
+UnixFileLength(char *name)
+{
+    int fd, length;
+
+    if ((fd = OpenForReadWrite(name, FALSE)) < 0)
+        return -1;
+    Lseek(fd, 0, 2);
+    length = Tell(fd);
+    Close(fd);
+    return length;
+}
+
+//----------------------------------------------------------------------
+// ReadUnixFile
+//      Read all of the UNIX file "name" into a new buffer, which the
+//	caller must delete.  Return NULL if the file can't be opened.
+//
+//	"length" -- set to the length of the file
+//----------------------------------------------------------------------
+
+static char *
+ReadUnixFile(char *name, int *length)
+{
+    int fd;
+    char *buffer;
+
+    if ((fd = OpenForReadWrite(name, FALSE)) < 0)
+        return NULL;
+    Lseek(fd, 0, 2);
+    *length = Tell(fd);
+    Lseek(fd, 0, 0);
+    buffer = new char[*length + 1];	// room for a NUL, for ReadList
+    Read(fd, buffer, *length);
+    Close(fd);
+    return buffer;
+}
+
+//----------------------------------------------------------------------
+// ReadList
+//      Read a list of pairs of file names, separated by white space,
+//	for Import and Export.  Return the number of pairs, or -1 if the
+//	list can't be read.
+//
+//	"names" -- set to an array of the names, first and second of
+//		each pair in turn; the caller deletes it, and "text"
+//	"text" -- set to the buffer holding the names
+//----------------------------------------------------------------------
+
+static int
+ReadList(char *listName, char ***names, char **text)
+{
+    int length, numNames = 0;
+    char *name;
+
+    if ((*text = ReadUnixFile(listName, &length)) == NULL)
+        return -1;
+    (*text)[length] = '\0';
+    *names = new char *[length / 2 + 1];	// more than enough
+    for (name = strtok(*text, " \t\n"); name != NULL;
+					name = strtok(NULL, " \t\n"))
+        (*names)[numNames++] = name;
+    if (numNames % 2 != 0)
+        printf("%s: %s has no partner, ignored\n", listName,
+					(*names)[numNames - 1]);
+    return numNames / 2;
+}
+
+//----------------------------------------------------------------------
+// CopyData
+//      Write "length" bytes from "buffer" into the Nachos file "to",
+//	which has already been created, in a single write.  The file's
+//	data blocks were allocated together (see FileHeader::Extend),
+//	so the write goes to the disk as one request per run of
+//	consecutive sectors (see OpenFile::WriteAt), rather than one
+//	request per sector.  Return FALSE if the file can't be opened
+//	(something removed it in the meantime).
+//----------------------------------------------------------------------
+
+static bool
+CopyData(char *buffer, int length, char *to)
+{
+    OpenFile* openFile = kernel->fileSystem->Open(to);
+
+    if (openFile == NULL)
+        return FALSE;
+    openFile->WriteAt(buffer, length, 0);
+    delete openFile;
+    return TRUE;
+}
 
-#ifndef FILESYS_STUB
 //----------------------------------------------------------------------
 // Copy
 //      Copy the contents of the UNIX file "from" to the Nachos file "to"
@@ -80,42 +185,130 @@ static const int TransferSize = 128;
 static void
 Copy(char *from, char *to)
 {
-    int fd;
-    OpenFile* openFile;
-    int amountRead, fileLength;
+    int fileLength;
     char *buffer;
 
-// Open UNIX file
-    if ((fd = OpenForReadWrite(from,FALSE)) < 0) {       
+    if ((buffer = ReadUnixFile(from, &fileLength)) == NULL) {
         printf("Copy: couldn't open input file %s\n", from);
         return;
     }
 
-// Figure out length of UNIX file
-    Lseek(fd, 0, 2);            
-    fileLength = Tell(fd);
-    Lseek(fd, 0, 0);
-
 // Create a Nachos file of the same length
     DEBUG('f', "Copying file " << from << " of size " << fileLength <<  " to file " << to);
-    if (!kernel->fileSystem->Create(to, fileLength)) {   // Create Nachos file
+    if (!kernel->fileSystem->Create(to, fileLength))    // Create Nachos file
         printf("Copy: couldn't create output file %s\n", to);
-        Close(fd);
+    else if (!CopyData(buffer, fileLength, to))
+        printf("Copy: couldn't open output file %s\n", to);
+    delete [] buffer;
+}
+
+//----------------------------------------------------------------------
+// Import
+//      Copy many UNIX files into Nachos, as listed in the UNIX file
+//	"listName".  All of the Nachos files are created first, in one
+//	batch (see FileSystem::BeginBatch), so that the directory and the
+//	bitmap are written once per commit rather than once per file;
+//	then the data of each file is copied in with a single write.
+//
+//	A UNIX file that disappears or changes size between the two
+//	passes is skipped, and its Nachos file removed again, rather
+//	than left with data that was never written.
+//----------------------------------------------------------------------
+
+static void
+Import(char *listName)
+{
+    char **names, *text, *buffer;
+    int numFiles, *lengths, length;
+    bool *created;
+
+    if ((numFiles = ReadList(listName, &names, &text)) < 0) {
+        printf("Import: couldn't open list file %s\n", listName);
         return;
     }
-    
-    openFile = kernel->fileSystem->Open(to);
-    ASSERT(openFile != NULL);
-    
-// Copy the data in TransferSize chunks
-    buffer = new char[TransferSize];
-    while ((amountRead=ReadPartial(fd, buffer, sizeof(char)*TransferSize)) > 0)
-        openFile->Write(buffer, amountRead);    
-    delete [] buffer;
+    lengths = new int[numFiles];
+    created = new bool[numFiles];
+
+    kernel->fileSystem->BeginBatch();
+    for (int i = 0; i < numFiles; i++) {
+        char *from = names[2 * i], *to = names[2 * i + 1];
+
+        created[i] = FALSE;
+        if ((lengths[i] = UnixFileLength(from)) < 0)
+            printf("Import: couldn't open input file %s\n", from);
+        else if (!kernel->fileSystem->Create(to, lengths[i]))
+            printf("Import: couldn't create output file %s\n", to);
+        else
+            created[i] = TRUE;
+    }
+    kernel->fileSystem->EndBatch();
+
+    for (int i = 0; i < numFiles; i++) {
+        char *from = names[2 * i], *to = names[2 * i + 1];
+
+        if (!created[i])
+            continue;
+        if ((buffer = ReadUnixFile(from, &length)) == NULL) {
+            printf("Import: couldn't open input file %s\n", from);
+            kernel->fileSystem->Remove(to);
+            continue;
+        }
+        if (length != lengths[i]) {
+            printf("Import: input file %s changed size, skipped\n", from);
+            kernel->fileSystem->Remove(to);
+        } else if (!CopyData(buffer, length, to))
+            printf("Import: couldn't open output file %s\n", to);
+        delete [] buffer;
+    }
+    DEBUG('f', "Imported " << numFiles << " files from " << listName);
 
-// Close the UNIX and the Nachos files
-    delete openFile;
-    Close(fd);
+    delete [] lengths;
+    delete [] created;
+    delete [] names;
+    delete [] text;
+}
+
+//----------------------------------------------------------------------
+// Export
+//      Copy many Nachos files out to UNIX, as listed in the UNIX file
+//	"listName".  Each file is read with a single read.
+//----------------------------------------------------------------------
+
+static void
+Export(char *listName)
+{
+    char **names, *text, *buffer;
+    int numFiles, length, fd;
+    OpenFile *openFile;
+
+    if ((numFiles = ReadList(listName, &names, &text)) < 0) {
+        printf("Export: couldn't open list file %s\n", listName);
+        return;
+    }
+    for (int i = 0; i < numFiles; i++) {
+        char *from = names[2 * i], *to = names[2 * i + 1];
+
+        if ((openFile = kernel->fileSystem->Open(from)) == NULL) {
+            printf("Export: unable to open file %s\n", from);
+            continue;
+        }
+        if ((fd = OpenForWrite(to)) < 0) {
+            printf("Export: couldn't create output file %s\n", to);
+            delete openFile;
+            continue;
+        }
+        length = openFile->Length();
+        buffer = new char[length];
+        length = openFile->ReadAt(buffer, length, 0);
+        WriteFile(fd, buffer, length);
+        Close(fd);
+        delete [] buffer;
+        delete openFile;
+    }
+    DEBUG('f', "Exported " << numFiles << " files from " << listName);
+
+    delete [] names;
+    delete [] text;
 }
 
 #endif // FILESYS_STUB
@@ -137,10 +330,12 @@ Print(char *name)
         return;
     }
     
-    buffer = new char[TransferSize];
-    while ((amountRead = openFile->Read(buffer, TransferSize)) > 0)
-        for (i = 0; i < amountRead; i++)
-            printf("%c", buffer[i]);
+// Read the whole file at once, which is one disk request per run of
+// consecutive sectors
+    buffer = new char[openFile->Length()];
+    amountRead = openFile->Read(buffer, openFile->Length());
+    for (i = 0; i < amountRead; i++)
+        printf("%c", buffer[i]);
     delete [] buffer;
 
     delete openFile;            // close the Nachos file
@@ -178,6 +373,10 @@ main(int argc, char **argv)
     char *printFileName = NULL; 
     char *removeFileName = NULL;
     bool dirListFlag = false;
+    char *mkdirName = NULL;           // Nachos directory to be created
+    char *recursiveListName = NULL;   // Nachos directory to be listed
+    char *importListName = NULL;      // UNIX files to be copied in
+    char *exportListName = NULL;      // Nachos files to be copied out
     bool dumpFlag = false;
 #endif //FILESYS_STUB
 
@@ -230,6 +429,26 @@ main(int argc, char **argv)
 	else if (strcmp(argv[i], "-D") == 0) {
 	    dumpFlag = true;
 	}
+	else if (strcmp(argv[i], "-mkdir") == 0) {
+	    ASSERT(i + 1 < argc);
+	    mkdirName = argv[i + 1];
+	    i++;
+	}
+	else if (strcmp(argv[i], "-lr") == 0) {
+	    ASSERT(i + 1 < argc);
+	    recursiveListName = argv[i + 1];
+	    i++;
+	}
+	else if (strcmp(argv[i], "-import") == 0) {
+	    ASSERT(i + 1 < argc);
+	    importListName = argv[i + 1];
+	    i++;
+	}
+	else if (strcmp(argv[i], "-export") == 0) {
+	    ASSERT(i + 1 < argc);
+	    exportListName = argv[i + 1];
+	    i++;
+	}
 #endif //FILESYS_STUB
 	else if (strcmp(argv[i], "-u") == 0) {
             cout << "Partial usage: nachos [-z -d debugFlags]\n";
@@ -239,6 +458,8 @@ main(int argc, char **argv)
             cout << "Partial usage: nachos [-cp UnixFile NachosFile]\n";
             cout << "Partial usage: nachos [-p fileName] [-r fileName]\n";
             cout << "Partial usage: nachos [-l] [-D]\n";
+            cout << "Partial usage: nachos [-mkdir dirName] [-lr dirName]\n";
+            cout << "Partial usage: nachos [-import listFile] [-export listFile]\n";
 #endif //FILESYS_STUB
 	}
 
@@ -269,15 +490,27 @@ main(int argc, char **argv)
     if (removeFileName != NULL) {
       kernel->fileSystem->Remove(removeFileName);
     }
+    if (mkdirName != NULL) {
+      kernel->fileSystem->Mkdir(mkdirName);
+    }
     if (copyUnixFileName != NULL && copyNachosFileName != NULL) {
       Copy(copyUnixFileName,copyNachosFileName);
     }
+    if (importListName != NULL) {
+      Import(importListName);
+    }
+    if (exportListName != NULL) {
+      Export(exportListName);
+    }
     if (dumpFlag) {
       kernel->fileSystem->Print();
     }
     if (dirListFlag) {
       kernel->fileSystem->List();
     }
+    if (recursiveListName != NULL) {
+      kernel->fileSystem->List(recursiveListName, TRUE);
+    }
     if (printFileName != NULL) {
       Print(printFileName);
     }
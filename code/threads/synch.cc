@@ -300,3 +300,200 @@ void Condition::Broadcast(Lock *conditionLock)
     Signal(conditionLock);
   }
 }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a reader-writer lock, so that it can be used for
+//	synchronization.  Initially, no one holds it.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(char *debugName)
+{
+  name = debugName;
+  lock = new Lock("rwlock");
+  canRead = new Condition("rwlock readers");
+  canWrite = new Condition("rwlock writers");
+  readers = new List<Thread *>;
+  waitingWriters = 0;
+  writer = NULL;
+  writeDepth = 0;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	Deallocate a reader-writer lock.  No one may be holding it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+  ASSERT(writer == NULL && readers->IsEmpty());
+  delete readers;
+  delete canWrite;
+  delete canRead;
+  delete lock;
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Wait until no thread is writing, or waiting to write, and then
+//	hold the lock for reading.  A thread that already holds the
+//	lock doesn't wait.
+//----------------------------------------------------------------------
+
+void RWLock::AcquireRead()
+{
+  Thread *me = kernel->currentThread;
+
+  lock->Acquire();
+  if (writer == me)
+  { // reading is implied by writing
+    writeDepth++;
+  }
+  else
+  {
+    if (!readers->IsInList(me))
+    { // a thread already reading must not wait, or it could
+      // deadlock with a waiting writer
+      while (writer != NULL || waitingWriters > 0)
+        canRead->Wait(lock);
+    }
+    readers->Append(me);
+  }
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Give up a hold on the lock taken by AcquireRead.  The last reader
+//	out lets in a waiting writer.
+//----------------------------------------------------------------------
+
+void RWLock::ReleaseRead()
+{
+  Thread *me = kernel->currentThread;
+
+  if (writer == me)
+  {
+    ReleaseWrite();
+    return;
+  }
+  lock->Acquire();
+  ASSERT(readers->IsInList(me));
+  readers->Remove(me);
+  if (readers->IsEmpty() && waitingWriters > 0)
+    canWrite->Signal(lock);
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Wait until no other thread holds the lock, and then hold it
+//	for writing.
+//----------------------------------------------------------------------
+
+void RWLock::AcquireWrite()
+{
+  Thread *me = kernel->currentThread;
+
+  lock->Acquire();
+  if (writer == me)
+  {
+    writeDepth++;
+  }
+  else
+  {
+    ASSERT(!readers->IsInList(me)); // can't upgrade a read hold
+    waitingWriters++;
+    while (writer != NULL || !readers->IsEmpty())
+      canWrite->Wait(lock);
+    waitingWriters--;
+    writer = me;
+    writeDepth = 1;
+  }
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Give up a hold on the lock taken by AcquireWrite (or by
+//	AcquireRead, while writing).  When the writer lets go for the
+//	last time, let in the next writer if there is one, otherwise
+//	all the waiting readers.
+//----------------------------------------------------------------------
+
+void RWLock::ReleaseWrite()
+{
+  lock->Acquire();
+  ASSERT(IsWriteHeldByCurrentThread());
+  if (--writeDepth == 0)
+  {
+    writer = NULL;
+    if (waitingWriters > 0)
+      canWrite->Signal(lock);
+    else
+      canRead->Broadcast(lock);
+  }
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// RWLock::SelfTest, RWSelfTestReader, RWSelfTestWriter
+// 	Test the reader-writer lock, by having several readers and a
+//	writer take turns with it, giving up the CPU while they hold it,
+//	and checking that the writer is always alone.
+//----------------------------------------------------------------------
+
+static int rwReaders, rwWriters;
+static Semaphore *rwDone;
+
+static void
+RWSelfTestReader(RWLock *rwLock)
+{
+  for (int i = 0; i < 5; i++)
+  {
+    rwLock->AcquireRead();
+    rwReaders++;
+    ASSERT(rwWriters == 0);
+    kernel->currentThread->Yield();
+    rwReaders--;
+    rwLock->ReleaseRead();
+    kernel->currentThread->Yield();
+  }
+  rwDone->V();
+}
+
+static void
+RWSelfTestWriter(RWLock *rwLock)
+{
+  for (int i = 0; i < 5; i++)
+  {
+    rwLock->AcquireWrite();
+    rwWriters++;
+    ASSERT(rwWriters == 1 && rwReaders == 0);
+    kernel->currentThread->Yield();
+    rwWriters--;
+    rwLock->ReleaseWrite();
+    kernel->currentThread->Yield();
+  }
+  rwDone->V();
+}
+
+void RWLock::SelfTest()
+{
+  const int numReaders = 3;
+
+  rwReaders = rwWriters = 0;
+  rwDone = new Semaphore("rwlock test", 0);
+  for (int i = 0; i < numReaders; i++)
+  {
+    Thread *reader = new Thread("rwlock reader", i + 1);
+    reader->Fork((VoidFunctionPtr)RWSelfTestReader, this);
+  }
+  Thread *writer = new Thread("rwlock writer", numReaders + 1);
+  writer->Fork((VoidFunctionPtr)RWSelfTestWriter, this);
+  for (int i = 0; i <= numReaders; i++)
+    rwDone->P();
+  delete rwDone;
+}
@@ -2,7 +2,8 @@
 //	Data structures for synchronizing threads.
 //
 //	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
+//	locks, and condition variables, plus reader-writer locks,
+//	built on top of the last two.  The implementation for
 //	semaphores is given; for the latter two, only the procedure
 //	interface is given -- they are to be implemented as part of 
 //	the first assignment.
@@ -141,4 +142,51 @@ class Condition {
     char* name;
     List<Semaphore *> *waitQueue;	// list of waiting threads
 };
+
+// The following class defines a "reader-writer lock".  Any number
+// of threads may hold the lock for reading at once, but a thread
+// holding it for writing holds it alone.  The operations are:
+//
+//	AcquireRead -- wait until no thread is writing, or waiting to
+//		write, then hold the lock for reading
+//
+//	AcquireWrite -- wait until no thread holds the lock, then hold
+//		it for writing
+//
+//	ReleaseRead, ReleaseWrite -- give up the lock
+//
+// Waiting writers are let in ahead of new readers, so that a steady
+// stream of readers can't keep writers out forever.
+//
+// A thread may acquire the lock again while it holds it (a reader
+// only for reading; a writer either way), as long as it releases it
+// as many times.  A reader may not go on to acquire it for writing.
+
+class RWLock {
+  public:
+    RWLock(char* debugName);		// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    char* getName() { return name; }	// debugging assist
+
+    void AcquireRead();			// hold the lock, shared
+    void ReleaseRead();
+    void AcquireWrite();		// hold the lock, exclusively
+    void ReleaseWrite();
+
+    bool IsWriteHeldByCurrentThread() {
+		return writer == kernel->currentThread; }
+
+    void SelfTest();			// test the lock implementation
+
+  private:
+    char *name;				// debugging assist
+    Lock *lock;				// protects the fields below
+    Condition *canRead;			// signalled when readers may go
+    Condition *canWrite;		// signalled when a writer may go
+    List<Thread *> *readers;		// one entry for each read hold
+    int waitingWriters;			// threads waiting in AcquireWrite
+    Thread *writer;			// thread holding it for writing
+    int writeDepth;			// how many times it holds it
+};
+
 #endif // SYNCH_H
@@ -21,6 +21,7 @@
 #include "switch.h"
 #include "synch.h"
 #include "sysdep.h"
+#include "disk.h"
 
 // this is put at the top of the execution stack, for detecting stack overflows
 const int STACK_FENCEPOST = 0xdedbeef;
@@ -46,6 +47,8 @@ Thread::Thread(char* threadName, int threadID)
 					// of machine registers
     }
     space = NULL;
+    scratch = NULL;
+    userTicks = systemTicks = 0;
 }
 
 //----------------------------------------------------------------------
@@ -66,6 +69,25 @@ Thread::~Thread()
     ASSERT(this != kernel->currentThread);
     if (stack != NULL)
 	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+    if (scratch != NULL)
+	delete [] scratch;
+}
+
+//----------------------------------------------------------------------
+// Thread::ScratchSector
+// 	Return a buffer of one disk sector that belongs to this thread.
+//	The file system reads partially covered sectors into it, so
+//	that reads and writes need not allocate a buffer per request.
+//	Since a thread can block in the middle of a disk request, the
+//	buffer cannot be shared between threads.
+//----------------------------------------------------------------------
+
+char *
+Thread::ScratchSector()
+{
+    if (scratch == NULL)
+	scratch = new char[SectorSize];
+    return scratch;
 }
 
 //----------------------------------------------------------------------
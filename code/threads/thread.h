@@ -107,6 +107,10 @@ class Thread {
     void Print() { cout << name; }
     void SelfTest();		// test whether thread impl is working
 
+    char *ScratchSector();	// Sector-sized buffer private to this
+				// thread, used by the file system for
+				// partially covered sectors
+
   private:
     // some of the private data for this class is listed above
     
@@ -116,6 +120,8 @@ class Thread {
     ThreadStatus status;	// ready, running or blocked
     char* name;
 	int   ID;
+    char *scratch;		// Buffer returned by ScratchSector(),
+				// NULL until first used
     void StackAllocate(VoidFunctionPtr func, void *arg);
     				// Allocate a stack for thread.
 				// Used internally by Fork()
@@ -131,6 +137,9 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+
+    int userTicks;			// Time spent running user code,
+    int systemTicks;			// and kernel code, on this thread
 };
 
 // external function, dummy routine whose sole job is to call Thread::Print
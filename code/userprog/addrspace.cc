@@ -20,6 +20,9 @@
 #include "addrspace.h"
 #include "machine.h"
 #include "noff.h"
+#include "ioring.h"
+#include "shm.h"
+#include "bitmap.h"
 
 //----------------------------------------------------------------------
 // SwapHeader
@@ -57,26 +60,30 @@ SwapHeader(NoffHeader *noffH)
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
-//	Set up the translation from program memory to physical
-//	memory.  For now, this is really simple (1:1), since we are
-//	only uniprogramming, and we have a single unsegmented page table
+//	Nothing is mapped yet; Load gives the program physical pages.
+//	We have a single unsegmented page table, with an entry for
+//	every virtual page, valid or not.
 //----------------------------------------------------------------------
 
 AddrSpace::AddrSpace()
 {
-  pageTable = new TranslationEntry[NumPhysPages];
-  for (int i = 0; i < NumPhysPages; i++)
+  pageTable = new TranslationEntry[NumVirtPages];
+  for (int i = 0; i < NumVirtPages; i++)
   {
-    pageTable[i].virtualPage = i; // for now, virt page # = phys page #
-    pageTable[i].physicalPage = i;
-    pageTable[i].valid = TRUE;
+    pageTable[i].virtualPage = i;
+    pageTable[i].physicalPage = 0;
+    pageTable[i].valid = FALSE;
     pageTable[i].use = FALSE;
     pageTable[i].dirty = FALSE;
     pageTable[i].readOnly = FALSE;
   }
+  numPages = 0;
 
-  // zero out the entire address space
-  bzero(kernel->machine->mainMemory, MemorySize);
+  openFiles = new DescriptorTable;
+  ring = NULL;
+  heapStart = brk = 0;
+  mappings = new List<Mapping *>;
+  numPageFaults = numDiskReads = numSyscalls = 0;
 }
 
 //----------------------------------------------------------------------
@@ -86,7 +93,89 @@ AddrSpace::AddrSpace()
 
 AddrSpace::~AddrSpace()
 {
+  openFiles->CloseAll(); // so that no call the ring is making waits on
+                         // a pipe end of ours
+  delete ring; // waits for any call the ring is making
+  while (!mappings->IsEmpty()) // detach every shared segment,
+  {                            // and write back every mapped file
+    Mapping *mapping = mappings->Front();
+
+    if (mapping->file != NULL)
+      Munmap(mapping->firstPage * PageSize);
+    else
+      kernel->sharedMemory->Detach(Detach(mapping->firstPage * PageSize));
+  }
+  delete mappings;
+  FreePages(0, numPages);
   delete pageTable;
+  delete openFiles;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocatePages
+// 	Map virtual pages "from" up to (not including) "to" to free
+//	physical pages, filled with zeros.  Return FALSE, mapping none of
+//	them, if there aren't enough free physical pages.
+//----------------------------------------------------------------------
+
+bool AddrSpace::AllocatePages(unsigned int from, unsigned int to)
+{
+  if (kernel->frameMap->NumClear() < (int)(to - from))
+    return FALSE;
+  for (unsigned int i = from; i < to; i++)
+  {
+    ASSERT(!pageTable[i].valid);
+    pageTable[i].physicalPage = kernel->frameMap->FindAndSet();
+    pageTable[i].valid = TRUE;
+    pageTable[i].use = FALSE;
+    pageTable[i].dirty = FALSE;
+    pageTable[i].readOnly = FALSE;
+    bzero(&kernel->machine->mainMemory[pageTable[i].physicalPage * PageSize],
+          PageSize);
+  }
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreePages
+// 	Unmap virtual pages "from" up to (not including) "to", giving
+//	their physical pages back to the kernel.
+//----------------------------------------------------------------------
+
+void AddrSpace::FreePages(unsigned int from, unsigned int to)
+{
+  for (unsigned int i = from; i < to; i++)
+  {
+    ASSERT(pageTable[i].valid);
+    kernel->frameMap->Clear(pageTable[i].physicalPage);
+    pageTable[i].valid = FALSE;
+  }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+// 	Read "size" bytes of the program, at "inFileAddr" in
+//	"executable", into its memory at "virtualAddr".  Each page is
+//	translated once, and read straight into its physical page.
+//----------------------------------------------------------------------
+
+void AddrSpace::LoadSegment(OpenFile *executable, int virtualAddr, int size,
+                            int inFileAddr)
+{
+  unsigned int paddr;
+  int chunk;
+
+  while (size > 0)
+  {
+    ExceptionType exception = Translate(virtualAddr, &paddr, 1);
+
+    ASSERT(exception == NoException);
+    chunk = min(size, PageSize - virtualAddr % PageSize);
+    executable->ReadAt(&kernel->machine->mainMemory[paddr], chunk, inFileAddr);
+    virtualAddr += chunk;
+    inFileAddr += chunk;
+    size -= chunk;
+  }
 }
 
 //----------------------------------------------------------------------
@@ -130,31 +219,36 @@ bool AddrSpace::Load(char *fileName)
 #endif
   numPages = divRoundUp(size, PageSize);
   size = numPages * PageSize;
+  heapStart = brk = size; // the heap is empty, until Sbrk grows it
 
-  ASSERT(numPages <= NumPhysPages); // check we're not trying
+  ASSERT(numPages <= NumVirtPages); // check we're not trying
       // to run anything too big --
       // at least until we have
       // virtual memory
 
   DEBUG(dbgAddr, "Initializing address space: " << numPages << ", " << size);
+  if (!AllocatePages(0, numPages))
+  {
+    cerr << "Not enough memory to run " << fileName << "\n";
+    numPages = 0;
+    delete executable;
+    return FALSE;
+  }
 
   // then, copy in the code and data segments into memory
-  // Note: this code assumes that virtual address = physical address
   if (noffH.code.size > 0)
   {
     DEBUG(dbgAddr, "Initializing code segment.");
     DEBUG(dbgAddr, noffH.code.virtualAddr << ", " << noffH.code.size);
-    executable->ReadAt(
-        &(kernel->machine->mainMemory[noffH.code.virtualAddr]),
-        noffH.code.size, noffH.code.inFileAddr);
+    LoadSegment(executable, noffH.code.virtualAddr,
+                noffH.code.size, noffH.code.inFileAddr);
   }
   if (noffH.initData.size > 0)
   {
     DEBUG(dbgAddr, "Initializing data segment.");
     DEBUG(dbgAddr, noffH.initData.virtualAddr << ", " << noffH.initData.size);
-    executable->ReadAt(
-        &(kernel->machine->mainMemory[noffH.initData.virtualAddr]),
-        noffH.initData.size, noffH.initData.inFileAddr);
+    LoadSegment(executable, noffH.initData.virtualAddr,
+                noffH.initData.size, noffH.initData.inFileAddr);
   }
 
 #ifdef RDATA
@@ -162,9 +256,8 @@ bool AddrSpace::Load(char *fileName)
   {
     DEBUG(dbgAddr, "Initializing read only data segment.");
     DEBUG(dbgAddr, noffH.readonlyData.virtualAddr << ", " << noffH.readonlyData.size);
-    executable->ReadAt(
-        &(kernel->machine->mainMemory[noffH.readonlyData.virtualAddr]),
-        noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
+    LoadSegment(executable, noffH.readonlyData.virtualAddr,
+                noffH.readonlyData.size, noffH.readonlyData.inFileAddr);
   }
 #endif
 
@@ -254,7 +347,7 @@ void AddrSpace::SaveState()
 void AddrSpace::RestoreState()
 {
   kernel->machine->pageTable = pageTable;
-  kernel->machine->pageTableSize = numPages;
+  kernel->machine->pageTableSize = NumVirtPages;
 }
 
 //----------------------------------------------------------------------
@@ -273,13 +366,18 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
   unsigned int vpn = vaddr / PageSize;
   unsigned int offset = vaddr % PageSize;
 
-  if (vpn >= numPages)
+  if (vpn >= NumVirtPages)
   {
     return AddressErrorException;
   }
 
   pte = &pageTable[vpn];
 
+  if (!pte->valid)
+  {
+    return PageFaultException;
+  }
+
   if (isReadWrite && pte->readOnly)
   {
     return ReadOnlyException;
@@ -309,3 +407,396 @@ AddrSpace::Translate(unsigned int vaddr, unsigned int *paddr, int isReadWrite)
 
   return NoException;
 }
+
+//----------------------------------------------------------------------
+// AddrSpace::Sbrk
+//  Move the end of the program's heap by "increment" bytes, and return
+//  where it was.  The heap starts right after the stack, at the end of
+//  the address space as loaded; growing it adds pages, filled with
+//  zeros, and shrinking it gives back pages that are no longer needed.
+//  Return -1, changing nothing, if the heap would shrink below nothing,
+//  or grow into a shared segment or mapped file, or there isn't enough
+//  memory.
+//----------------------------------------------------------------------
+
+int AddrSpace::Sbrk(int increment)
+{
+  unsigned int oldBrk = brk;
+  unsigned int newPages;
+
+  if (increment < 0 && (unsigned int)-increment > brk - heapStart)
+    return -1;
+  if (increment > 0 && (unsigned int)increment > MemorySize - brk)
+    return -1;
+  newPages = divRoundUp(brk + increment, PageSize);
+  for (unsigned int i = numPages; i < newPages; i++)
+    if (!PageFree(i))
+      return -1;
+  if (newPages > numPages && !AllocatePages(numPages, newPages))
+    return -1;
+
+  DEBUG(dbgAddr, "Moving the break from " << brk << " by " << increment);
+  if (newPages < numPages)
+    FreePages(newPages, numPages);
+  else if (increment > 0 && brk % PageSize != 0)
+  {
+    // the rest of the last page may have been used before; new pages
+    // are already zero
+    unsigned int paddr;
+    ExceptionType exception = Translate(brk, &paddr, 1);
+
+    ASSERT(exception == NoException);
+    bzero(&kernel->machine->mainMemory[paddr],
+          min((unsigned int)increment, PageSize - brk % PageSize));
+  }
+  numPages = newPages;
+  brk += increment;
+  return oldBrk;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FindMapping
+//  Return the shared segment or mapped file that virtual page "page"
+//  is part of, or NULL if it isn't part of one.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::FindMapping(unsigned int page)
+{
+  ListIterator<Mapping *> iter(mappings);
+
+  for (; !iter.IsDone(); iter.Next())
+    if (page >= (unsigned int)iter.Item()->firstPage
+        && page < (unsigned int)(iter.Item()->firstPage + iter.Item()->numPages))
+      return iter.Item();
+  return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageFree
+//  Return TRUE if virtual page "page" is not in use: not mapped, and
+//  not set aside for a mapped file to be read into.
+//----------------------------------------------------------------------
+
+bool AddrSpace::PageFree(unsigned int page)
+{
+  return page < NumVirtPages && !pageTable[page].valid
+         && FindMapping(page) == NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddMapping
+//  Find "pages" free virtual pages in a row, as high up as there are
+//  some (but above the heap), and note that they are taken by
+//  "segment" or "file".  Return the mapping, or NULL if there is no
+//  room.  The caller fills in the page table.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::AddMapping(int pages, SharedSegment *segment, OpenFile *file)
+{
+  Mapping *mapping;
+  int first, run = 0;
+
+  for (first = NumVirtPages - 1; first >= (int)numPages; first--)
+  {
+    run = PageFree(first) ? run + 1 : 0;
+    if (run == pages)
+      break;
+  }
+  if (pages <= 0 || run < pages)
+    return NULL;
+
+  mapping = new Mapping;
+  mapping->firstPage = first;
+  mapping->numPages = pages;
+  mapping->segment = segment;
+  mapping->file = file;
+  mappings->Append(mapping);
+  return mapping;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveMapping
+//  Return the mapping that starts at "vaddr", taking it off the list
+//  of mappings; NULL if none starts there.  Only shared segments
+//  (if "isFile" is FALSE), or only mapped files, are looked at.
+//----------------------------------------------------------------------
+
+Mapping *
+AddrSpace::RemoveMapping(unsigned int vaddr, bool isFile)
+{
+  ListIterator<Mapping *> iter(mappings);
+  Mapping *mapping;
+
+  for (; !iter.IsDone(); iter.Next())
+  {
+    mapping = iter.Item();
+    if ((unsigned int)mapping->firstPage * PageSize == vaddr
+        && (mapping->file != NULL) == isFile)
+    {
+      mappings->Remove(mapping);
+      return mapping;
+    }
+  }
+  return NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Attach
+//  Map the pages of a shared memory segment into the address space,
+//  as high up as there is room for them.  Return the address of the
+//  segment, or -1 if there is no room.
+//----------------------------------------------------------------------
+
+int AddrSpace::Attach(SharedSegment *segment)
+{
+  Mapping *mapping = AddMapping(segment->numPages, segment, NULL);
+  int first;
+
+  if (mapping == NULL)
+    return -1;
+  first = mapping->firstPage;
+  for (int i = 0; i < segment->numPages; i++)
+  {
+    pageTable[first + i].physicalPage = segment->frames[i];
+    pageTable[first + i].valid = TRUE;
+    pageTable[first + i].use = FALSE;
+    pageTable[first + i].dirty = FALSE;
+    pageTable[first + i].readOnly = FALSE;
+  }
+  DEBUG(dbgAddr, "Attached " << segment->name << " at page " << first);
+  return first * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Detach
+//  Unmap the shared memory segment whose address is "vaddr" (as
+//  returned by Attach).  Return the segment, for the caller to give
+//  back, or NULL if no segment is attached there.
+//----------------------------------------------------------------------
+
+SharedSegment *
+AddrSpace::Detach(unsigned int vaddr)
+{
+  Mapping *mapping = RemoveMapping(vaddr, FALSE);
+  SharedSegment *segment;
+
+  if (mapping == NULL)
+    return NULL;
+  segment = mapping->segment;
+  for (int i = 0; i < segment->numPages; i++)
+    pageTable[mapping->firstPage + i].valid = FALSE;
+  delete mapping;
+  DEBUG(dbgAddr, "Detached " << segment->name);
+  return segment;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Mmap
+//  Set aside room in the address space for all of "file", as high up
+//  as there is room for it.  Nothing is read yet: each page is read
+//  in from the file when the program first touches it (see
+//  PageFault).  The address space now owns "file".
+//  Return the address of the file's first byte, or -1 (in which case
+//  the caller still owns "file") if the file is empty or there is
+//  no room.
+//----------------------------------------------------------------------
+
+int AddrSpace::Mmap(OpenFile *file)
+{
+  int length = file->Length();
+  Mapping *mapping;
+
+  if (length <= 0)
+    return -1;
+  mapping = AddMapping(divRoundUp(length, PageSize), NULL, file);
+  if (mapping == NULL)
+    return -1;
+  mapping->length = length;
+  DEBUG(dbgAddr, "Mapped " << length << " bytes at page " << mapping->firstPage);
+  return mapping->firstPage * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Munmap
+//  Unmap the file mapped at "vaddr" (as returned by Mmap), writing
+//  back the pages that were changed, and close it.  What was written
+//  past the end of the file, in its last page, is lost; the file
+//  doesn't grow.  Return FALSE if no file is mapped there.
+//----------------------------------------------------------------------
+
+bool AddrSpace::Munmap(unsigned int vaddr)
+{
+  Mapping *mapping = RemoveMapping(vaddr, TRUE);
+  TranslationEntry *entry;
+  int offset;
+
+  if (mapping == NULL)
+    return FALSE;
+  for (int i = 0; i < mapping->numPages; i++)
+  {
+    entry = &pageTable[mapping->firstPage + i];
+    if (!entry->valid)
+      continue; // never read in
+    offset = i * PageSize;
+    if (entry->dirty)
+    {
+      DEBUG(dbgAddr, "Writing back page " << i << " of a mapped file");
+      mapping->file->WriteAt(
+          &kernel->machine->mainMemory[entry->physicalPage * PageSize],
+          min(PageSize, mapping->length - offset), offset);
+    }
+    kernel->frameMap->Clear(entry->physicalPage);
+    entry->valid = FALSE;
+  }
+  delete mapping->file;
+  delete mapping;
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageFault
+//  The program touched the page at "vaddr", which isn't in memory.
+//  If it is part of a mapped file, read the page in from the file,
+//  into a free physical page, and return TRUE, so that the access
+//  can be tried again.  Return FALSE if the address is bad, or there
+//  is no memory left.
+//----------------------------------------------------------------------
+
+bool AddrSpace::PageFault(unsigned int vaddr)
+{
+  unsigned int page = vaddr / PageSize;
+  Mapping *mapping = (page < NumVirtPages) ? FindMapping(page) : NULL;
+  TranslationEntry *entry;
+  int frame, offset;
+
+  if (mapping == NULL || mapping->file == NULL)
+    return FALSE;
+  frame = kernel->frameMap->FindAndSet();
+  if (frame == -1)
+    return FALSE;
+
+  // read the page in before it is valid, so no one sees it half read
+  DEBUG(dbgAddr, "Reading in page " << page << " of a mapped file");
+  kernel->stats->numPageFaults++;
+  numPageFaults++;
+  offset = (page - mapping->firstPage) * PageSize;
+  bzero(&kernel->machine->mainMemory[frame * PageSize], PageSize);
+  mapping->file->ReadAt(&kernel->machine->mainMemory[frame * PageSize],
+                        min(PageSize, mapping->length - offset), offset);
+
+  entry = &pageTable[page];
+  if (entry->valid) // someone else read it in while we waited
+  {
+    kernel->frameMap->Clear(frame);
+    return TRUE;
+  }
+  entry->physicalPage = frame;
+  entry->valid = TRUE;
+  entry->use = FALSE;
+  entry->dirty = FALSE;
+  entry->readOnly = FALSE;
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TranslateOrFault
+//  Translate "vaddr" as Translate does, but first reading the page in,
+//  if it is part of a mapped file that isn't in memory yet.
+//----------------------------------------------------------------------
+
+ExceptionType
+AddrSpace::TranslateOrFault(unsigned int vaddr, unsigned int *paddr,
+                            int isReadWrite)
+{
+  ExceptionType exception = Translate(vaddr, paddr, isReadWrite);
+
+  if (exception == PageFaultException && PageFault(vaddr))
+    exception = Translate(vaddr, paddr, isReadWrite);
+  return exception;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyIn
+// AddrSpace::CopyOut
+//  Copy "numBytes" bytes between the program's memory, at virtual
+//  address _vaddr_, and a buffer in the kernel.  Each page is
+//  translated once, and the part of it that is wanted copied as a
+//  whole, rather than translating every byte (as Machine::ReadMem
+//  does).  Pages of mapped files are read in as needed.
+//  Return FALSE, having copied only part of the data, if some of the
+//  addresses are bad (or, for CopyOut, read-only).
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyIn(unsigned int vaddr, char *into, int numBytes)
+{
+  unsigned int paddr;
+  int chunk;
+
+  if (numBytes < 0 || numBytes > MemorySize)
+    return FALSE;
+  while (numBytes > 0)
+  {
+    if (TranslateOrFault(vaddr, &paddr, 0) != NoException)
+      return FALSE;
+    chunk = min(numBytes, PageSize - (int)(vaddr % PageSize));
+    bcopy(&kernel->machine->mainMemory[paddr], into, chunk);
+    vaddr += chunk;
+    into += chunk;
+    numBytes -= chunk;
+  }
+  return TRUE;
+}
+
+bool AddrSpace::CopyOut(char *from, unsigned int vaddr, int numBytes)
+{
+  unsigned int paddr;
+  int chunk;
+
+  if (numBytes < 0 || numBytes > MemorySize)
+    return FALSE;
+  while (numBytes > 0)
+  {
+    if (TranslateOrFault(vaddr, &paddr, 1) != NoException)
+      return FALSE;
+    chunk = min(numBytes, PageSize - (int)(vaddr % PageSize));
+    bcopy(from, &kernel->machine->mainMemory[paddr], chunk);
+    vaddr += chunk;
+    from += chunk;
+    numBytes -= chunk;
+  }
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyInString
+//  Copy a null-terminated string, at virtual address _vaddr_ in the
+//  program's memory, into "into", which has room for "maxLength"
+//  bytes including the null.  The string is copied a page at a time.
+//  Return FALSE if an address is bad, or the string is too long.
+//----------------------------------------------------------------------
+
+bool AddrSpace::CopyInString(unsigned int vaddr, char *into, int maxLength)
+{
+  unsigned int paddr;
+  int chunk;
+  char *end;
+
+  while (maxLength > 0)
+  {
+    if (TranslateOrFault(vaddr, &paddr, 0) != NoException)
+      return FALSE;
+    chunk = min(maxLength, PageSize - (int)(vaddr % PageSize));
+    end = (char *)memchr(&kernel->machine->mainMemory[paddr], '\0', chunk);
+    if (end != NULL)
+      chunk = end - &kernel->machine->mainMemory[paddr] + 1;
+    bcopy(&kernel->machine->mainMemory[paddr], into, chunk);
+    if (end != NULL)
+      return TRUE;
+    vaddr += chunk;
+    into += chunk;
+    maxLength -= chunk;
+  }
+  return FALSE;
+}
@@ -2,7 +2,13 @@
 //	Data structures to keep track of executing user programs 
 //	(address spaces).
 //
-//	For now, we don't keep any information about address spaces.
+//	Each address space has physical pages of its own, taken from the
+//	kernel's map of free pages (kernel->frameMap), so that several
+//	programs can be in memory at once.  The program and its heap are
+//	at the bottom of the address space; shared memory segments and
+//	mapped files are mapped in at the top.  A mapped file is read in
+//	a page at a time, as the program touches it (see PageFault).
+//
 //	The user level CPU state is saved and restored in the thread
 //	executing the user program (see thread.h).
 //
@@ -15,8 +21,26 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "fdtable.h"
+#include "list.h"
+
+class IoRing;
+class SharedSegment;
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define NumVirtPages		NumPhysPages	// size of an address space
+
+// The following class defines a shared memory segment attached to an
+// address space, or a file mapped into it.
+
+class Mapping {
+  public:
+    int firstPage;			// Where it is, in the address space
+    int numPages;			// How many pages it takes up
+    SharedSegment *segment;		// The segment there, or NULL
+    OpenFile *file;			// The file there, or NULL
+    int length;				// How long the file is
+};
 
 class AddrSpace {
   public:
@@ -39,11 +63,64 @@ class AddrSpace {
     // is 0 for Read, 1 for Write.
     ExceptionType Translate(unsigned int vaddr, unsigned int *paddr, int mode);
 
+    // Copy data between the program's memory and the kernel's,
+    // translating each page once.  Return FALSE if any of the
+    // program's addresses are bad.
+    bool CopyIn(unsigned int vaddr, char *into, int numBytes);
+    bool CopyOut(char *from, unsigned int vaddr, int numBytes);
+    bool CopyInString(unsigned int vaddr, char *into, int maxLength);
+
+    int Sbrk(int increment);		// Grow (or shrink) the heap;
+					// return the old end of it, or -1
+
+    int Attach(SharedSegment *segment);	// Map "segment" in; return its
+					// address, or -1 if there's no room
+    SharedSegment *Detach(unsigned int vaddr);
+					// Unmap the segment at "vaddr";
+					// return it, or NULL if none is
+
+    int Mmap(OpenFile *file);		// Map "file" in; return its
+					// address, or -1 if there's no room
+    bool Munmap(unsigned int vaddr);	// Write back and unmap the file
+					// at "vaddr"
+    bool PageFault(unsigned int vaddr);	// Read in the page of a mapped
+					// file at "vaddr"; return FALSE if
+					// there is none
+
+    DescriptorTable *openFiles;		// Files opened by the program
+    int numPageFaults;			// Counts of what the program has
+    int numDiskReads;			// done, for GetPerfCounters
+    int numSyscalls;
+    IoRing *ring;			// Its system call ring, or NULL
+
   private:
     TranslationEntry *pageTable;	// Assume linear page table translation
 					// for now!
-    unsigned int numPages;		// Number of pages in the virtual 
-					// address space
+    unsigned int numPages;		// Number of pages of the program
+					// and its heap
+    unsigned int heapStart;		// Where the heap starts, above the
+					// stack
+    unsigned int brk;			// Where it ends (the "break")
+    List<Mapping *> *mappings;		// Shared segments attached
+
+    bool AllocatePages(unsigned int from, unsigned int to);
+					// Give pages "from" up to "to" new,
+					// zeroed physical pages
+    void FreePages(unsigned int from, unsigned int to);
+					// And give them back
+    Mapping *FindMapping(unsigned int page);
+					// The mapping "page" is part of
+    bool PageFree(unsigned int page);	// Is "page" unused?
+    Mapping *AddMapping(int pages, SharedSegment *segment, OpenFile *file);
+					// Set aside room for a mapping
+    Mapping *RemoveMapping(unsigned int vaddr, bool isFile);
+					// Take back the room
+    ExceptionType TranslateOrFault(unsigned int vaddr, unsigned int *paddr,
+				   int isReadWrite);
+					// Translate, reading the page in
+					// if need be
+    void LoadSegment(OpenFile *executable, int virtualAddr, int size,
+		     int inFileAddr);	// Read part of the program in
 
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
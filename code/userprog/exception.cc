@@ -4,8 +4,7 @@
 //	transfer back to here from user code:
 //
 //	syscall -- The user code explicitly requests to call a procedure
-//	in the Nachos kernel.  Right now, the only function we support is
-//	"Halt".
+//	in the Nachos kernel.
 //
 //	exceptions -- The user code does something that the CPU can't handle.
 //	For instance, accessing memory that doesn't exist, arithmetic errors,
@@ -14,8 +13,19 @@
 //	Interrupts (which can also cause control to transfer from user
 //	code into the Nachos kernel) are handled elsewhere.
 //
-// For now, this only handles the Halt() system call.
-// Everything else core dumps.
+//	System calls are dispatched through a table, indexed by the
+//	call's number, of handler routines.  Each handler is given the
+//	call's arguments and returns its result; the common code around
+//	it reads the arguments out of the registers, stores the result,
+//	advances the program counter, and records how many times each
+//	call is made and how long it takes (see Statistics).  To add a
+//	system call, write a handler and register it in RegisterSyscalls.
+//
+//	Calls submitted through a program's system call ring go through
+//	the same handlers (see ioring.h).
+//
+//	A page fault is taken to mean the program touched a page of a
+//	mapped file that hasn't been read in yet (see AddrSpace::PageFault).
 //
 // Copyright (c) 1992-1996 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation
@@ -25,6 +35,378 @@
 #include "main.h"
 #include "syscall.h"
 #include "ksyscall.h"
+#include "ioring.h"
+#include "futex.h"
+
+// The longest string (such as a file name) a system call can be given
+#define MaxStringArg 256
+
+// A system call handler is passed the call's arguments, from
+// registers 4 to 7, and returns the call's result, to be put in
+// register 2.  Handlers ignore the arguments they don't need.
+typedef int (*SyscallHandler)(int arg1, int arg2, int arg3, int arg4);
+
+// The handler for each system call, by number; NULL if there is none
+static SyscallHandler syscallTable[MaxSyscallStats];
+static bool syscallsRegistered = FALSE;
+
+//----------------------------------------------------------------------
+// The system call handlers.  Arguments that point into the user
+// program's memory are copied in and out through its page table
+// (see AddrSpace::CopyIn).
+//----------------------------------------------------------------------
+
+static int
+HandleHalt(int, int, int, int)
+{
+  DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
+  SysHalt();
+  ASSERTNOTREACHED();
+  return 0;
+}
+
+static int
+HandleExit(int status, int, int, int)
+{
+  AddrSpace *space = kernel->currentThread->space;
+
+  DEBUG(dbgAddr, "Program exit\n");
+  cout << "return value:" << status << endl;
+  kernel->currentThread->space = NULL; // no more user code to run
+  delete space; // closes its files, and stops its ring
+  kernel->currentThread->Finish();
+  ASSERTNOTREACHED();
+  return 0;
+}
+
+static int
+HandlePrintInt(int val, int, int, int)
+{
+  DEBUG(dbgSys, "Print Int\n");
+  DEBUG(dbgTraCode, "In ExceptionHandler(), into SysPrintInt, " << kernel->stats->totalTicks);
+  SysPrintInt(val);
+  DEBUG(dbgTraCode, "In ExceptionHandler(), return from SysPrintInt, " << kernel->stats->totalTicks);
+  return 0;
+}
+
+static int
+HandleMSG(int msgAddr, int, int, int)
+{
+  char msg[MaxStringArg];
+
+  DEBUG(dbgSys, "Message received.\n");
+  if (kernel->currentThread->space->CopyInString(msgAddr, msg, MaxStringArg))
+    cout << msg << endl;
+  SysHalt();
+  ASSERTNOTREACHED();
+  return 0;
+}
+
+static int
+HandleAdd(int op1, int op2, int, int)
+{
+  int result;
+
+  DEBUG(dbgSys, "Add " << op1 << " + " << op2 << "\n");
+  result = SysAdd(op1, op2);
+  DEBUG(dbgSys, "Add returning with " << result << "\n");
+  cout << "result is " << result << "\n";
+  return result;
+}
+
+static int
+HandleCreate(int nameAddr, int, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return 0; // bad address, or name too long
+  return SysCreate(name);
+}
+
+static int
+HandleRemove(int nameAddr, int, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return 0;
+  return SysRemove(name);
+}
+
+static int
+HandleOpen(int nameAddr, int, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return -1;
+  return SysOpen(name);
+}
+
+static int
+HandleWrite(int bufferAddr, int size, int fd, int)
+{
+  char *buffer;
+  int status;
+
+  // copy the data into the kernel a page at a time, and write it
+  // all in one go
+  if (size < 0 || size > MemorySize)
+    return -1;
+  buffer = new char[size];
+  if (!kernel->currentThread->space->CopyIn(bufferAddr, buffer, size))
+    status = -1;
+  else
+    status = SysWrite(buffer, size, fd);
+  delete [] buffer;
+  return status;
+}
+
+static int
+HandleRead(int bufferAddr, int size, int fd, int)
+{
+  char *buffer;
+  int numChar;
+
+  // read into the kernel, then copy out only what was read, a page
+  // at a time
+  if (size < 0 || size > MemorySize)
+    return -1;
+  buffer = new char[size];
+  numChar = SysRead(buffer, size, fd);
+  if (numChar > 0 && !kernel->currentThread->space->CopyOut(buffer, bufferAddr, numChar))
+    numChar = -1; // bad address
+  delete [] buffer;
+  return numChar;
+}
+
+static int
+HandleSeek(int position, int fd, int, int)
+{
+  return SysSeek(position, fd);
+}
+
+static int
+HandleClose(int fd, int, int, int)
+{
+  return SysClose(fd);
+}
+
+static int
+HandlePipe(int nameAddr, int fdsAddr, int, int)
+{
+  AddrSpace *space = kernel->currentThread->space;
+  char name[MaxStringArg];
+  OpenFileId fds[2];
+
+  if (nameAddr != 0 && !space->CopyInString(nameAddr, name, MaxStringArg))
+    return -1;
+  if (SysPipe(nameAddr != 0 ? name : NULL, fds) != 1)
+    return -1;
+  if (!space->CopyOut((char *)fds, fdsAddr, sizeof(fds)))
+  {
+    SysClose(fds[0]); // nowhere to put the descriptors
+    SysClose(fds[1]);
+    return -1;
+  }
+  return 1;
+}
+
+static int
+HandleShmCreate(int nameAddr, int size, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return -1;
+  return SysShmCreate(name, size);
+}
+
+static int
+HandleShmAttach(int nameAddr, int, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return -1;
+  return SysShmAttach(name);
+}
+
+static int
+HandleShmDetach(int addr, int, int, int)
+{
+  return SysShmDetach(addr);
+}
+
+static int
+HandleFutexWait(int addr, int expected, int, int)
+{
+  return kernel->futexes->Wait(kernel->currentThread->space, addr, expected);
+}
+
+static int
+HandleFutexWake(int addr, int count, int, int)
+{
+  return kernel->futexes->Wake(kernel->currentThread->space, addr, count);
+}
+
+static int
+HandleMmap(int nameAddr, int, int, int)
+{
+  char name[MaxStringArg];
+
+  if (!kernel->currentThread->space->CopyInString(nameAddr, name, MaxStringArg))
+    return -1;
+  return SysMmap(name);
+}
+
+static int
+HandleMunmap(int addr, int, int, int)
+{
+  return SysMunmap(addr);
+}
+
+static int
+HandleSleep(int ticks, int, int, int)
+{
+  if (ticks > 0)
+    kernel->alarm->WaitUntil(ticks);
+  return 0;
+}
+
+static int
+HandleGetTicks(int, int, int, int)
+{
+  return kernel->stats->totalTicks;
+}
+
+static int
+HandleGetPerfCounters(int countersAddr, int, int, int)
+{
+  AddrSpace *space = kernel->currentThread->space;
+  PerfCounters counters;
+
+  counters.totalTicks = kernel->stats->totalTicks;
+  counters.userTicks = kernel->currentThread->userTicks;
+  counters.systemTicks = kernel->currentThread->systemTicks;
+  counters.pageFaults = space->numPageFaults;
+  counters.diskReads = space->numDiskReads;
+  counters.syscalls = space->numSyscalls;
+  if (!space->CopyOut((char *)&counters, countersAddr, sizeof(PerfCounters)))
+    return -1;
+  return 1;
+}
+
+static int
+HandleSbrk(int increment, int, int, int)
+{
+  return kernel->currentThread->space->Sbrk(increment);
+}
+
+static int
+HandleRingSetup(int ringAddr, int, int, int)
+{
+  AddrSpace *space = kernel->currentThread->space;
+  SyscallRing ring;
+
+  // the whole ring must be in the program's memory, and writable
+  if (space->ring != NULL
+      || !space->CopyIn(ringAddr, (char *)&ring, sizeof(SyscallRing))
+      || !space->CopyOut((char *)&ring, ringAddr, sizeof(SyscallRing)))
+    return -1;
+  space->ring = new IoRing(space, ringAddr);
+  return 1;
+}
+
+static int
+HandleRingEnter(int minComplete, int, int, int)
+{
+  AddrSpace *space = kernel->currentThread->space;
+
+  if (space->ring == NULL)
+    return -1;
+  return space->ring->Enter(minComplete);
+}
+
+//----------------------------------------------------------------------
+// RegisterSyscall
+// 	Install "handler" as the handler for system call number "which",
+//	and register the call's name for the statistics.
+//----------------------------------------------------------------------
+
+static void
+RegisterSyscall(int which, const char *name, SyscallHandler handler)
+{
+  ASSERT(which >= 0 && which < MaxSyscallStats);
+  ASSERT(syscallTable[which] == NULL);
+  syscallTable[which] = handler;
+  kernel->stats->AddSyscall(which, name);
+}
+
+//----------------------------------------------------------------------
+// RegisterSyscalls
+// 	Fill in the table of system call handlers; done the first time
+//	a user program makes a system call.
+//----------------------------------------------------------------------
+
+static void
+RegisterSyscalls()
+{
+  RegisterSyscall(SC_Halt, "Halt", HandleHalt);
+  RegisterSyscall(SC_Exit, "Exit", HandleExit);
+  RegisterSyscall(SC_Create, "Create", HandleCreate);
+  RegisterSyscall(SC_Remove, "Remove", HandleRemove);
+  RegisterSyscall(SC_Open, "Open", HandleOpen);
+  RegisterSyscall(SC_Read, "Read", HandleRead);
+  RegisterSyscall(SC_Write, "Write", HandleWrite);
+  RegisterSyscall(SC_Seek, "Seek", HandleSeek);
+  RegisterSyscall(SC_Close, "Close", HandleClose);
+  RegisterSyscall(SC_PrintInt, "PrintInt", HandlePrintInt);
+  RegisterSyscall(SC_RingSetup, "RingSetup", HandleRingSetup);
+  RegisterSyscall(SC_RingEnter, "RingEnter", HandleRingEnter);
+  RegisterSyscall(SC_Sbrk, "Sbrk", HandleSbrk);
+  RegisterSyscall(SC_Pipe, "Pipe", HandlePipe);
+  RegisterSyscall(SC_ShmCreate, "ShmCreate", HandleShmCreate);
+  RegisterSyscall(SC_ShmAttach, "ShmAttach", HandleShmAttach);
+  RegisterSyscall(SC_ShmDetach, "ShmDetach", HandleShmDetach);
+  RegisterSyscall(SC_FutexWait, "FutexWait", HandleFutexWait);
+  RegisterSyscall(SC_FutexWake, "FutexWake", HandleFutexWake);
+  RegisterSyscall(SC_Mmap, "Mmap", HandleMmap);
+  RegisterSyscall(SC_Munmap, "Munmap", HandleMunmap);
+  RegisterSyscall(SC_Sleep, "Sleep", HandleSleep);
+  RegisterSyscall(SC_GetTicks, "GetTicks", HandleGetTicks);
+  RegisterSyscall(SC_GetPerfCounters, "GetPerfCounters", HandleGetPerfCounters);
+  RegisterSyscall(SC_Add, "Add", HandleAdd);
+  RegisterSyscall(SC_MSG, "MSG", HandleMSG);
+  syscallsRegistered = TRUE;
+}
+
+//----------------------------------------------------------------------
+// DoSyscall
+// 	Make the system call numbered "which", which has a handler, with
+//	the given arguments; return its result.  The call is counted,
+//	and the time it takes added up, in the statistics.
+//----------------------------------------------------------------------
+
+int DoSyscall(int which, int arg1, int arg2, int arg3, int arg4)
+{
+  Statistics *stats = kernel->stats;
+  int result, startTicks;
+
+  if (!syscallsRegistered)
+    RegisterSyscalls();
+  ASSERT(which >= 0 && which < MaxSyscallStats && syscallTable[which] != NULL);
+
+  // count the call first, since some (like Exit) never return
+  stats->syscallCalls[which]++;
+  kernel->currentThread->space->numSyscalls++;
+  startTicks = stats->totalTicks;
+  result = (*syscallTable[which])(arg1, arg2, arg3, arg4);
+  stats->syscallTicks[which] += stats->totalTicks - startTicks;
+  return result;
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 // 	Entry point into the Nachos kernel.  Called when a user program
@@ -49,149 +431,39 @@
 //----------------------------------------------------------------------
 void ExceptionHandler(ExceptionType which)
 {
-  char ch;
-  int val;
   int type = kernel->machine->ReadRegister(2);
-  int status, exit, threadID, programID, fileID, numChar;
+  int result;
+
   DEBUG(dbgSys, "Received Exception " << which << " type: " << type << "\n");
   DEBUG(dbgTraCode, "In ExceptionHandler(), Received Exception " << which << " type: " << type << ", " << kernel->stats->totalTicks);
   switch (which)
   {
   case SyscallException:
-    switch (type)
+    if (!syscallsRegistered)
+      RegisterSyscalls();
+    if (type < 0 || type >= MaxSyscallStats || syscallTable[type] == NULL)
     {
-    case SC_Halt:
-      DEBUG(dbgSys, "Shutdown, initiated by user program.\n");
-      SysHalt();
-      cout << "in exception\n";
-      ASSERTNOTREACHED();
-      break;
-    case SC_PrintInt:
-      DEBUG(dbgSys, "Print Int\n");
-      val = kernel->machine->ReadRegister(4);
-      DEBUG(dbgTraCode, "In ExceptionHandler(), into SysPrintInt, " << kernel->stats->totalTicks);
-      SysPrintInt(val);
-      DEBUG(dbgTraCode, "In ExceptionHandler(), return from SysPrintInt, " << kernel->stats->totalTicks);
-      // Set Program Counter
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_MSG:
-      DEBUG(dbgSys, "Message received.\n");
-      val = kernel->machine->ReadRegister(4);
-      {
-        char *msg = &(kernel->machine->mainMemory[val]);
-        cout << msg << endl;
-      }
-      SysHalt();
-      ASSERTNOTREACHED();
-      break;
-    case SC_Create:
-      val = kernel->machine->ReadRegister(4);
-      {
-        char *filename = &(kernel->machine->mainMemory[val]);
-        // cout << filename << endl;
-        fileID = SysCreate(filename);
-        kernel->machine->WriteRegister(2, (int)fileID);
-      }
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Open:
-      val = kernel->machine->ReadRegister(4);
-
-      {
-        char *filename = &(kernel->machine->mainMemory[val]);
-        //cout << filename << endl;
-        fileID = SysOpen(filename);
-        kernel->machine->WriteRegister(2, (int)fileID);
-      }
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Write:
-      val = kernel->machine->ReadRegister(4);
-      {
-        char *buffer = &(kernel->machine->mainMemory[val]);
-        //cout << filename << endl;
-        status = SysWrite(buffer, kernel->machine->ReadRegister(5), kernel->machine->ReadRegister(6));
-        kernel->machine->WriteRegister(2, (int)status);
-      }
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Read:
-      val = kernel->machine->ReadRegister(4);
-      {
-        char *buffer = &(kernel->machine->mainMemory[val]);
-        numChar = SysRead(buffer, kernel->machine->ReadRegister(5), kernel->machine->ReadRegister(6));
-        kernel->machine->WriteRegister(2, (int)numChar);
-      }
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Close:
-      val = kernel->machine->ReadRegister(4);
-      {
-        //cout << filename << endl;
-        status = SysClose(val);
-        kernel->machine->WriteRegister(2, (int)status);
-      }
-      kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-      kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Add:
-      DEBUG(dbgSys, "Add " << kernel->machine->ReadRegister(4) << " + " << kernel->machine->ReadRegister(5) << "\n");
-      /* Process SysAdd Systemcall*/
-      int result;
-      result = SysAdd(/* int op1 */ (int)kernel->machine->ReadRegister(4),
-                      /* int op2 */ (int)kernel->machine->ReadRegister(5));
-      DEBUG(dbgSys, "Add returning with " << result << "\n");
-      /* Prepare Result */
-      kernel->machine->WriteRegister(2, (int)result);
-      /* Modify return point */
-      {
-        /* set previous programm counter (debugging only)*/
-        kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
-
-        /* set programm counter to next instruction (all Instructions are 4 byte wide)*/
-        kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
-
-        /* set next programm counter for brach execution */
-        kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
-      }
-      cout << "result is " << result << "\n";
-      return;
-      ASSERTNOTREACHED();
-      break;
-    case SC_Exit:
-      DEBUG(dbgAddr, "Program exit\n");
-      val = kernel->machine->ReadRegister(4);
-      cout << "return value:" << val << endl;
-      kernel->currentThread->Finish();
-      break;
-    default:
       cerr << "Unexpected system call " << type << "\n";
       break;
     }
+    result = DoSyscall(type, kernel->machine->ReadRegister(4),
+                       kernel->machine->ReadRegister(5),
+                       kernel->machine->ReadRegister(6),
+                       kernel->machine->ReadRegister(7));
+
+    // return the result, and go on to the instruction after the
+    // syscall (all instructions are 4 bytes wide)
+    kernel->machine->WriteRegister(2, result);
+    kernel->machine->WriteRegister(PrevPCReg, kernel->machine->ReadRegister(PCReg));
+    kernel->machine->WriteRegister(PCReg, kernel->machine->ReadRegister(PCReg) + 4);
+    kernel->machine->WriteRegister(NextPCReg, kernel->machine->ReadRegister(PCReg) + 4);
+    return;
+  case PageFaultException:
+    // read in the page, if it is part of a mapped file, and try the
+    // instruction again (the PC hasn't moved)
+    if (kernel->currentThread->space->PageFault(kernel->machine->ReadRegister(BadVAddrReg)))
+      return;
+    cerr << "Bad address " << kernel->machine->ReadRegister(BadVAddrReg) << "\n";
     break;
   default:
     cerr << "Unexpected user mode exception " << (int)which << "\n";
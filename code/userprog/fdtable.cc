@@ -0,0 +1,252 @@
+// fdtable.cc 
+//	Routines to manage a user program's table of open files.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "fdtable.h"
+#include "pipe.h"
+#include "synch.h"
+#include "syscall.h"
+#include "debug.h"
+#include "main.h"
+
+//----------------------------------------------------------------------
+// DescriptorTable::DescriptorTable
+// 	Initialize an empty table, except that the console descriptors
+//	are taken.
+//----------------------------------------------------------------------
+
+DescriptorTable::DescriptorTable()
+{
+  size = InitialOpenFiles;
+  entries = new Descriptor *[size];
+  for (int i = 0; i < size; i++)
+    entries[i] = NULL;
+  inUse = new Bitmap(size);
+  inUse->Mark(SysConsoleInput);
+  inUse->Mark(SysConsoleOutput);
+  lock = new Lock("descriptor table lock");
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::~DescriptorTable
+// 	Close any files and pipes the program left open, and de-allocate
+//	the table.  No system call may be using the table any more.
+//----------------------------------------------------------------------
+
+DescriptorTable::~DescriptorTable()
+{
+  for (int i = 0; i < size; i++)
+    if (entries[i] != NULL)
+    {
+      ASSERT(entries[i]->users == 0);
+      Destroy(entries[i]);
+    }
+  delete [] entries;
+  delete inUse;
+  delete lock;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Destroy
+// 	Close the file or pipe end "desc" stands for, and de-allocate it.
+//	Called once it is out of the table and no one holds it.
+//----------------------------------------------------------------------
+
+void DescriptorTable::Destroy(Descriptor *desc)
+{
+  if (desc->file != NULL)
+    delete desc->file;
+  else
+    kernel->pipeTable->Close(desc->pipe, desc->writeEnd);
+  delete desc;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Grow
+// 	Double the number of descriptors, copying over the ones in use.
+//	Return FALSE if the table is already as big as it may get.
+//	Called with "lock" held.
+//----------------------------------------------------------------------
+
+bool DescriptorTable::Grow()
+{
+  int newSize = size * 2;
+  Descriptor **newEntries;
+  Bitmap *newInUse;
+
+  if (newSize > MaxOpenFiles)
+    return FALSE;
+  newEntries = new Descriptor *[newSize];
+  newInUse = new Bitmap(newSize);
+  for (int i = 0; i < newSize; i++)
+  {
+    newEntries[i] = (i < size) ? entries[i] : NULL;
+    if (i < size && inUse->Test(i))
+      newInUse->Mark(i);
+  }
+  delete [] entries;
+  delete inUse;
+  entries = newEntries;
+  inUse = newInUse;
+  size = newSize;
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Allocate
+// 	Put "desc" in the table under the lowest free descriptor, growing
+//	the table if it is full.  Return the descriptor, or -1 if the
+//	program has too many files open.
+//----------------------------------------------------------------------
+
+int DescriptorTable::Allocate(Descriptor *desc)
+{
+  int fd = -1;
+
+  lock->Acquire();
+  if (inUse->NumClear() > 0 || Grow())
+  {
+    fd = inUse->FindAndSetLowest();
+    ASSERT(fd != -1 && entries[fd] == NULL);
+    entries[fd] = desc;
+  }
+  lock->Release();
+  return fd;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Add
+// 	Put a file the program has opened into the table, under the
+//	lowest free descriptor, growing the table if it is full.
+//	Return the descriptor, or -1 if the program has too many files
+//	open, in which case the caller still owns "file".
+//----------------------------------------------------------------------
+
+int DescriptorTable::Add(OpenFile *file)
+{
+  Descriptor *desc = new Descriptor;
+  int fd;
+
+  desc->file = file;
+  desc->pipe = NULL;
+  desc->writeEnd = FALSE;
+  desc->users = 0;
+  desc->closed = FALSE;
+  fd = Allocate(desc);
+  if (fd == -1)
+    delete desc;
+  return fd;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::AddPipe
+// 	Put the read end (or the write end) of "pipe" into the table, as
+//	Add does for files.  Return -1 if the program has too many files
+//	open, in which case the caller must close that end.
+//----------------------------------------------------------------------
+
+int DescriptorTable::AddPipe(PipeBuffer *pipe, bool writeEnd)
+{
+  Descriptor *desc = new Descriptor;
+  int fd;
+
+  desc->file = NULL;
+  desc->pipe = pipe;
+  desc->writeEnd = writeEnd;
+  desc->users = 0;
+  desc->closed = FALSE;
+  fd = Allocate(desc);
+  if (fd == -1)
+    delete desc;
+  return fd;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Hold
+// 	Return what descriptor "fd" stands for, or NULL if "fd" isn't a
+//	descriptor for a file or a pipe end (including the console
+//	descriptors).  The file or pipe end stays open, even if "fd" is
+//	closed, until the caller gives it back with Release.
+//----------------------------------------------------------------------
+
+Descriptor *
+DescriptorTable::Hold(int fd)
+{
+  Descriptor *desc = NULL;
+
+  lock->Acquire();
+  if (fd >= 0 && fd < size && entries[fd] != NULL)
+  {
+    desc = entries[fd];
+    desc->users++;
+  }
+  lock->Release();
+  return desc;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Release
+// 	Give back a descriptor returned by Hold.  If it was closed while
+//	it was held, and no one else holds it, close what it stands for.
+//----------------------------------------------------------------------
+
+void DescriptorTable::Release(Descriptor *desc)
+{
+  bool last;
+
+  lock->Acquire();
+  ASSERT(desc->users > 0);
+  last = (--desc->users == 0 && desc->closed);
+  lock->Release();
+  if (last)
+    Destroy(desc);
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::Close
+// 	Free descriptor "fd", and close the file or pipe end it stands
+//	for -- at once, unless a system call is holding it, in which case
+//	the last one to let go of it does so.  Return FALSE if "fd" isn't
+//	a descriptor for either.
+//----------------------------------------------------------------------
+
+bool DescriptorTable::Close(int fd)
+{
+  Descriptor *desc = NULL;
+  bool unused = FALSE;
+
+  lock->Acquire();
+  if (fd >= 0 && fd < size && entries[fd] != NULL)
+  {
+    desc = entries[fd];
+    entries[fd] = NULL;
+    inUse->Clear(fd);
+    desc->closed = TRUE;
+    unused = (desc->users == 0);
+  }
+  lock->Release();
+  if (desc == NULL)
+    return FALSE;
+  if (unused)
+    Destroy(desc);
+  else if (desc->pipe != NULL)
+    desc->pipe->WakeUp(); // in case a holder is waiting on it
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// DescriptorTable::CloseAll
+// 	Close every descriptor, when the program exits.  A call its
+//	system call ring is making on a pipe end stops waiting, so that
+//	the ring can be stopped.
+//----------------------------------------------------------------------
+
+void DescriptorTable::CloseAll()
+{
+  for (int fd = 0; fd < size; fd++)
+    Close(fd);
+}
@@ -0,0 +1,93 @@
+// fdtable.h 
+//	Data structures for a user program's table of open files.
+//
+//	A user program names the files it has open by small integers,
+//	"descriptors", as in UNIX.  Each program has its own table,
+//	kept in its address space, mapping its descriptors to OpenFiles.
+//	A newly opened file always gets the lowest free descriptor.
+//
+//	A descriptor may also be one end of a pipe (see pipe.h) instead
+//	of a file; closing it closes that end.
+//
+//	Descriptors 0 and 1 (SysConsoleInput and SysConsoleOutput) are
+//	set aside for the console when the table is created; they have
+//	no OpenFile behind them, and can't be closed.
+//
+//	The table starts small, and doubles in size when it fills up,
+//	up to MaxOpenFiles descriptors.  Free descriptors are kept in a
+//	bitmap, so that the lowest one is found without looking at every
+//	entry.  Deleting the table closes every file and pipe still in it.
+//
+//	A program's table is used by the thread running the program and
+//	by the thread serving its system call ring (see ioring.h) at the
+//	same time.  A system call holds the descriptor it works on (Hold)
+//	until it is done with it (Release); if the descriptor is closed
+//	meanwhile, it is freed at once, but the file or pipe end behind
+//	it is only closed once the last holder lets go of it.  A call
+//	waiting on a pipe end that is closed stops waiting, so that a
+//	program can always exit: CloseAll closes everything, before the
+//	program's ring is stopped.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FDTABLE_H
+#define FDTABLE_H
+
+#include "copyright.h"
+#include "bitmap.h"
+#include "openfile.h"
+
+class PipeBuffer;
+class Lock;
+
+#define InitialOpenFiles	16	// size of a new table
+#define MaxOpenFiles		1024	// files a program can have open
+
+// The following class defines what a descriptor stands for: an open
+// file, or one end of a pipe.
+
+class Descriptor {
+  public:
+    OpenFile *file;			// The open file, or NULL
+    PipeBuffer *pipe;			// Or the pipe, or NULL
+    bool writeEnd;			// Which end of it
+    int users;				// System calls holding it
+    bool closed;			// Is it no longer in the table?
+};
+
+class DescriptorTable {
+  public:
+    DescriptorTable();			// Initialize a table with only
+					// the console descriptors in use
+    ~DescriptorTable();			// Close every file left open
+
+    int Add(OpenFile *file);		// Give "file" the lowest free
+					// descriptor; return -1 if the
+					// table can't grow any more
+    int AddPipe(PipeBuffer *pipe, bool writeEnd);
+					// Give one end of "pipe" the lowest
+					// free descriptor, as for Add
+    Descriptor *Hold(int fd);		// What "fd" stands for, or NULL;
+					// kept open until Release
+    void Release(Descriptor *desc);	// Done with what Hold returned
+    bool Close(int fd);			// Close the file or pipe end with
+					// descriptor "fd"; return FALSE
+					// if none
+    void CloseAll();			// Close every descriptor
+
+  private:
+    Descriptor **entries;		// What each descriptor stands for
+    Bitmap *inUse;			// Which descriptors are taken
+    int size;				// Number of descriptors in "entries"
+    Lock *lock;				// Protects all of the above, and
+					// each entry's "users"
+
+    bool Grow();			// Double the size of the table
+    int Allocate(Descriptor *desc);	// Give "desc" the lowest free
+					// descriptor
+    void Destroy(Descriptor *desc);	// Close the file or pipe end
+};
+
+#endif // FDTABLE_H
@@ -0,0 +1,151 @@
+// futex.cc
+//	Routines to put threads to sleep on words in user memory, and
+//	wake them up.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "futex.h"
+#include "main.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// QueueGetKey, AddressHash
+// 	Helper routines used by the hash table to find a queue's key,
+//	and to hash a key.
+//----------------------------------------------------------------------
+
+static unsigned int
+QueueGetKey(FutexQueue *queue)
+{
+  return queue->paddr;
+}
+
+static unsigned
+AddressHash(unsigned int paddr)
+{
+  return (paddr / sizeof(int)) * 2654435761u;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::FutexTable
+// 	Initialize an empty table; no one is waiting.
+//----------------------------------------------------------------------
+
+FutexTable::FutexTable()
+{
+  queues = new HashTable<unsigned int, FutexQueue *>(QueueGetKey, AddressHash);
+}
+
+//----------------------------------------------------------------------
+// FutexTable::~FutexTable
+// 	De-allocate the table, at shutdown.  Threads still waiting are
+//	never woken up.
+//----------------------------------------------------------------------
+
+FutexTable::~FutexTable()
+{
+  while (!queues->IsEmpty())
+  {
+    HashIterator<unsigned int, FutexQueue *> iter(queues);
+    FutexQueue *queue = iter.Item();
+
+    queues->Remove(queue->paddr);
+    delete queue->waiters;
+    delete queue;
+  }
+  delete queues;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wait
+// 	If the word at "vaddr" in "space" holds "expected", put the
+//	current thread to sleep until a Wake on the same word.
+//	Return 1 once woken, 0 at once if the word holds something
+//	else, or -1 if "vaddr" isn't the address of a word in "space".
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wait(AddrSpace *space, unsigned int vaddr, int expected)
+{
+  IntStatus oldLevel;
+  FutexQueue *queue;
+  unsigned int paddr;
+  int value;
+
+  if (vaddr % sizeof(int) != 0)
+    return -1;
+
+  // nothing can change the word between reading it and going to sleep
+  oldLevel = kernel->interrupt->SetLevel(IntOff);
+  if (space->Translate(vaddr, &paddr, 0) != NoException)
+  {
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return -1;
+  }
+  value = WordToHost(*(unsigned int *)&kernel->machine->mainMemory[paddr]);
+  if (value != expected)
+  {
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return 0;
+  }
+
+  if (!queues->Find(paddr, &queue))
+  {
+    queue = new FutexQueue;
+    queue->paddr = paddr;
+    queue->waiters = new List<Thread *>;
+    queues->Insert(queue);
+  }
+  DEBUG(dbgSys, "Waiting on the word at " << paddr);
+  queue->waiters->Append(kernel->currentThread);
+  kernel->currentThread->Sleep(FALSE);
+  (void)kernel->interrupt->SetLevel(oldLevel);
+  return 1;
+}
+
+//----------------------------------------------------------------------
+// FutexTable::Wake
+// 	Wake up to "count" of the threads waiting on the word at "vaddr"
+//	in "space", the ones that have waited longest first.  Return how
+//	many were woken, or -1 if "vaddr" isn't the address of a word.
+//----------------------------------------------------------------------
+
+int
+FutexTable::Wake(AddrSpace *space, unsigned int vaddr, int count)
+{
+  IntStatus oldLevel;
+  FutexQueue *queue;
+  unsigned int paddr;
+  int woken = 0;
+
+  if (vaddr % sizeof(int) != 0)
+    return -1;
+
+  // ReadyToRun assumes that interrupts are disabled
+  oldLevel = kernel->interrupt->SetLevel(IntOff);
+  if (space->Translate(vaddr, &paddr, 0) != NoException)
+  {
+    (void)kernel->interrupt->SetLevel(oldLevel);
+    return -1;
+  }
+  if (queues->Find(paddr, &queue))
+  {
+    while (woken < count && !queue->waiters->IsEmpty())
+    {
+      kernel->scheduler->ReadyToRun(queue->waiters->RemoveFront());
+      woken++;
+    }
+    if (queue->waiters->IsEmpty())
+    {
+      queues->Remove(paddr);
+      delete queue->waiters;
+      delete queue;
+    }
+  }
+  (void)kernel->interrupt->SetLevel(oldLevel);
+  DEBUG(dbgSys, "Woke " << woken << " waiting on the word at " << paddr);
+  return woken;
+}
@@ -0,0 +1,58 @@
+// futex.h
+//	Data structures for futexes: waiting, in the kernel, for a word
+//	in a user program's memory to change.
+//
+//	A user program synchronizes through words in its own memory
+//	(or in shared memory), and calls into the kernel only when it
+//	has to wait.  Wait puts the calling thread to sleep, but only if
+//	the word still holds the value the program last saw; Wake wakes
+//	threads waiting on the word.  Checking the word and going to
+//	sleep happen with interrupts off, so a Wake can't slip in between.
+//
+//	Waiting threads are kept in a hash table of queues, keyed by the
+//	physical address of the word, so that programs sharing memory
+//	wait on the same queue whatever address each has it at.  A queue
+//	exists only while someone is waiting on it.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "copyright.h"
+#include "hash.h"
+#include "list.h"
+
+class AddrSpace;
+class Thread;
+
+// The following class defines the threads waiting on one word.
+
+class FutexQueue {
+  public:
+    unsigned int paddr;			// The word's physical address
+    List<Thread *> *waiters;		// Threads waiting, in order
+};
+
+// The following class defines the table of futexes, kept by the kernel.
+
+class FutexTable {
+  public:
+    FutexTable();			// Initialize an empty table
+    ~FutexTable();			// De-allocate the table
+
+    int Wait(AddrSpace *space, unsigned int vaddr, int expected);
+					// Sleep until woken, if the word
+					// at "vaddr" is "expected"
+    int Wake(AddrSpace *space, unsigned int vaddr, int count);
+					// Wake up to "count" threads
+					// waiting on the word at "vaddr"
+
+  private:
+    HashTable<unsigned int, FutexQueue *> *queues;
+					// Queues with waiters, by address
+};
+
+#endif // FUTEX_H
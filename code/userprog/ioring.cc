@@ -0,0 +1,240 @@
+// ioring.cc 
+//	Routines to serve a user program's system call ring.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "ioring.h"
+#include "main.h"
+#include "addrspace.h"
+
+#include <stddef.h>
+
+// Where things are in a SyscallRing
+#define SubmitHead	offsetof(SyscallRing, submitHead)
+#define SubmitTail	offsetof(SyscallRing, submitTail)
+#define CompleteHead	offsetof(SyscallRing, completeHead)
+#define CompleteTail	offsetof(SyscallRing, completeTail)
+#define Submission(i)	(offsetof(SyscallRing, submissions) \
+			 + ((i) % RingEntries) * sizeof(RingSubmission))
+#define Completion(i)	(offsetof(SyscallRing, completions) \
+			 + ((i) % RingEntries) * sizeof(RingCompletion))
+
+//----------------------------------------------------------------------
+// ServeRing
+// 	Body of the thread that serves a ring.
+//----------------------------------------------------------------------
+
+static void
+ServeRing(IoRing *ring)
+{
+  ring->Serve();
+}
+
+//----------------------------------------------------------------------
+// IoRing::IoRing
+// 	Start serving the ring at "ringAddr" in the program's memory.
+//	The ring's indices are taken as they are; a new ring should have
+//	them all zero.
+//----------------------------------------------------------------------
+
+IoRing::IoRing(AddrSpace *s, int addr)
+{
+  Thread *server;
+
+  space = s;
+  ringAddr = addr;
+  submitHead = ReadIndex(SubmitHead);
+  completeTail = ReadIndex(CompleteTail);
+  stopping = FALSE;
+  lock = new Lock("ring lock");
+  workToDo = new Condition("ring work");
+  completed = new Condition("ring completed");
+  stopped = new Semaphore("ring stopped", 0);
+
+  server = new Thread("ring server", -1);
+  server->space = space; // makes the calls on behalf of the program
+  server->Fork((VoidFunctionPtr) ServeRing, (void *) this);
+}
+
+//----------------------------------------------------------------------
+// IoRing::~IoRing
+// 	Stop serving the ring, waiting for the serving thread to finish
+//	the call it is making, if any.
+//----------------------------------------------------------------------
+
+IoRing::~IoRing()
+{
+  lock->Acquire();
+  stopping = TRUE;
+  workToDo->Signal(lock);
+  completed->Broadcast(lock);
+  lock->Release();
+  stopped->P();
+
+  delete lock;
+  delete workToDo;
+  delete completed;
+  delete stopped;
+}
+
+//----------------------------------------------------------------------
+// IoRing::ReadIndex
+// IoRing::WriteIndex
+// 	Read or write one of the ring's indices, in the program's memory.
+//	The ring was checked when it was registered, so the addresses are
+//	good.
+//----------------------------------------------------------------------
+
+int
+IoRing::ReadIndex(int offset)
+{
+  int value = 0;
+
+  space->CopyIn(ringAddr + offset, (char *)&value, sizeof(int));
+  return value;
+}
+
+void
+IoRing::WriteIndex(int offset, int value)
+{
+  space->CopyOut((char *)&value, ringAddr + offset, sizeof(int));
+}
+
+//----------------------------------------------------------------------
+// IoRing::Ready
+// IoRing::Outstanding
+// 	Return the number of completions the program hasn't reaped, and
+//	the number of submissions the kernel hasn't completed.  Garbage
+//	in the program's indices counts as nothing.
+//----------------------------------------------------------------------
+
+int
+IoRing::Ready()
+{
+  int n = completeTail - ReadIndex(CompleteHead);
+
+  return (n > 0 && n <= RingEntries) ? n : 0;
+}
+
+int
+IoRing::Outstanding()
+{
+  int n = ReadIndex(SubmitTail) - completeTail;
+
+  return (n > 0 && n <= 2 * RingEntries) ? n : 0;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Fetch
+// 	Take the next submission from the ring, if there is one and there
+//	is room to complete it.  Return FALSE if there is nothing to do.
+//----------------------------------------------------------------------
+
+bool
+IoRing::Fetch(RingSubmission *entry)
+{
+  int pending = ReadIndex(SubmitTail) - submitHead;
+
+  if (pending <= 0 || pending > RingEntries)
+    return FALSE; // nothing submitted (or garbage)
+  if (completeTail - ReadIndex(CompleteHead) >= RingEntries)
+    return FALSE; // no room for the result
+  space->CopyIn(ringAddr + Submission(submitHead), (char *)entry,
+                sizeof(RingSubmission));
+  submitHead++;
+  WriteIndex(SubmitHead, submitHead);
+  return TRUE;
+}
+
+//----------------------------------------------------------------------
+// IoRing::Complete
+// 	Put the result of a call in the completion ring.
+//----------------------------------------------------------------------
+
+void
+IoRing::Complete(int result, int userData)
+{
+  RingCompletion entry;
+
+  entry.result = result;
+  entry.userData = userData;
+  space->CopyOut((char *)&entry, ringAddr + Completion(completeTail),
+                 sizeof(RingCompletion));
+  completeTail++;
+  WriteIndex(CompleteTail, completeTail);
+}
+
+//----------------------------------------------------------------------
+// IoRing::Serve
+// 	Make the calls submitted to the ring, one after another, until
+//	the program exits.  Only calls on files may be submitted; any
+//	other gets -1 as its result.
+//----------------------------------------------------------------------
+
+void
+IoRing::Serve()
+{
+  RingSubmission entry;
+  int result;
+
+  lock->Acquire();
+  while (!stopping)
+  {
+    if (!Fetch(&entry))
+    {
+      workToDo->Wait(lock);
+      continue;
+    }
+    lock->Release();
+    switch (entry.type)
+    {
+    case SC_Create:
+    case SC_Remove:
+    case SC_Open:
+    case SC_Read:
+    case SC_Write:
+    case SC_Seek:
+    case SC_Close:
+      result = DoSyscall(entry.type, entry.arg1, entry.arg2, entry.arg3, 0);
+      break;
+    default:
+      result = -1;
+      break;
+    }
+    lock->Acquire();
+    Complete(result, entry.userData);
+    completed->Broadcast(lock);
+  }
+  lock->Release();
+
+  kernel->currentThread->space = NULL; // the program is going away
+  stopped->V();
+  kernel->currentThread->Finish();
+}
+
+//----------------------------------------------------------------------
+// IoRing::Enter
+// 	Wake up the serving thread, to look for new submissions (or for
+//	room to post completions), then wait until "minComplete"
+//	completions are ready for the program, or no calls are left
+//	outstanding.  Return the number of completions ready.
+//----------------------------------------------------------------------
+
+int
+IoRing::Enter(int minComplete)
+{
+  int ready;
+
+  if (minComplete > RingEntries)
+    minComplete = RingEntries;
+  lock->Acquire();
+  workToDo->Signal(lock);
+  while (!stopping && Ready() < minComplete && Outstanding() > 0)
+    completed->Wait(lock);
+  ready = Ready();
+  lock->Release();
+  return ready;
+}
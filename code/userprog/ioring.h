@@ -0,0 +1,72 @@
+// ioring.h 
+//	Data structures for serving a user program's system call ring.
+//
+//	A program that registers a SyscallRing (see syscall.h) gets a
+//	kernel thread of its own, which takes system calls from the ring
+//	as they are submitted, makes them on the program's behalf, and
+//	puts the results back in the ring.  The program traps into the
+//	kernel once per batch (RingEnter) instead of once per call.
+//
+//	The ring lives in the program's memory; it is read and written
+//	through the program's page table (see AddrSpace::CopyIn).  The
+//	kernel keeps its own copy of the indices it owns, so a program
+//	that scribbles on them only confuses itself.
+//
+//	The serving thread shares the program's address space, so the
+//	calls it makes use the program's open files; they go through the
+//	same handlers as trapped system calls (see exception.cc).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef IORING_H
+#define IORING_H
+
+#include "copyright.h"
+#include "syscall.h"
+#include "synch.h"
+
+class AddrSpace;
+class Thread;
+
+// Make system call "which", as if the current thread had trapped with
+// these arguments (see exception.cc).
+extern int DoSyscall(int which, int arg1, int arg2, int arg3, int arg4);
+
+class IoRing {
+  public:
+    IoRing(AddrSpace *space, int ringAddr);
+					// Start serving the ring at
+					// "ringAddr" in "space"
+    ~IoRing();				// Stop serving it, once the call
+					// in progress (if any) is done
+
+    int Enter(int minComplete);		// Note new submissions, and wait
+					// for "minComplete" completions
+
+    void Serve();			// The serving thread's main loop
+
+  private:
+    AddrSpace *space;			// The program the ring belongs to
+    int ringAddr;			// Where the ring is, in "space"
+    int submitHead;			// Our copies of the indices only
+    int completeTail;			// the kernel writes
+    bool stopping;			// Has the program exited?
+
+    Lock *lock;				// Protects all of the above
+    Condition *workToDo;		// Signalled by Enter and ~IoRing
+    Condition *completed;		// Signalled when a call is done
+    Semaphore *stopped;			// V'ed when the thread is done
+
+    int ReadIndex(int offset);		// Read one index from the ring
+    void WriteIndex(int offset, int value);
+					// Write one index to the ring
+    bool Fetch(RingSubmission *entry);	// Take the next submission
+    void Complete(int result, int userData);
+					// Post a completion
+    int Ready();			// Completions not yet reaped
+    int Outstanding();			// Submissions not yet completed
+};
+
+#endif // IORING_H
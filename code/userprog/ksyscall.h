@@ -14,6 +14,8 @@
 #include "kernel.h"
 
 #include "synchconsole.h"
+#include "pipe.h"
+#include "shm.h"
 
 void SysHalt()
 {
@@ -37,28 +39,203 @@ int SysCreate(char *filename)
   // return value
   // 1: success
   // 0: failed
+#ifdef FILESYS_STUB
   return kernel->fileSystem->Create(filename);
+#else
+  // the file starts out empty, and grows as it is written
+  return kernel->fileSystem->Create(filename, 0);
+#endif
 }
 
-int SysRead(char *buffer, int size, int fd) {
-  return kernel->fileSystem->Read(buffer, size, fd);
+// Each program has its own table of open files, kept in its address
+// space; descriptors index it.  The console descriptors aren't in the
+// table, and go to the console instead.  Pipe ends are in the table
+// too, but aren't OpenFiles.  A call holds the descriptor it uses
+// until it is done, in case the program's system call ring closes it
+// meanwhile (see fdtable.h).
+
+int SysRead(char *buffer, int size, int fd)
+{
+  DescriptorTable *openFiles = kernel->currentThread->space->openFiles;
+  Descriptor *desc;
+  int i, result;
+
+  if (size < 0)
+    return -1;
+  if (fd == SysConsoleInput)
+  {
+    // return what has been typed, up to the end of the line
+    for (i = 0; i < size; i++)
+    {
+      buffer[i] = kernel->synchConsoleIn->GetChar();
+      if (buffer[i] == (char)EOF)
+        break;
+      if (buffer[i] == '\n')
+      {
+        i++;
+        break;
+      }
+    }
+    return i;
+  }
+  desc = openFiles->Hold(fd);
+  if (desc == NULL)
+    return -1;
+  if (desc->file != NULL)
+    result = desc->file->Read(buffer, size);
+  else if (!desc->writeEnd)
+    result = desc->pipe->Read(buffer, size, &desc->closed);
+  else
+    result = -1;
+  openFiles->Release(desc);
+  return result;
 }
 
 int SysWrite(char *buffer, int size, int fd)
 {
-  return kernel->fileSystem->Write(buffer, size, fd);
+  DescriptorTable *openFiles = kernel->currentThread->space->openFiles;
+  Descriptor *desc;
+  int result;
+
+  if (size < 0)
+    return -1;
+  if (fd == SysConsoleOutput)
+  {
+    for (int i = 0; i < size; i++)
+      kernel->synchConsoleOut->PutChar(buffer[i]);
+    return size;
+  }
+  desc = openFiles->Hold(fd);
+  if (desc == NULL)
+    return -1;
+  if (desc->file != NULL)
+    result = desc->file->Write(buffer, size);
+  else if (desc->writeEnd)
+    result = desc->pipe->Write(buffer, size, &desc->closed);
+  else
+    result = -1;
+  openFiles->Release(desc);
+  return result;
 }
 
-int SysClose(int fd)
+int SysSeek(int position, int fd)
 {
-  return kernel->fileSystem->Close(fd);
+  DescriptorTable *openFiles = kernel->currentThread->space->openFiles;
+  Descriptor *desc = openFiles->Hold(fd);
+  int result = -1;
+
+  if (desc == NULL)
+    return -1;
+  if (desc->file != NULL && position >= 0)
+  {
+    desc->file->Seek(position);
+    result = 1;
+  }
+  openFiles->Release(desc);
+  return result;
 }
 
-//When you finish the function "OpenAFile", you can remove the comment below.
+int SysClose(int fd)
+{
+  return kernel->currentThread->space->openFiles->Close(fd) ? 1 : -1;
+}
 
 OpenFileId SysOpen(char *name)
 {
-  return kernel->fileSystem->OpenAFile(name);
+  OpenFile *openFile = kernel->fileSystem->Open(name);
+  OpenFileId fd;
+
+  if (openFile == NULL)
+    return -1;
+  fd = kernel->currentThread->space->openFiles->Add(openFile);
+  if (fd == -1)
+    delete openFile; // too many files open
+  return fd;
+}
+
+// Open the pipe "name" (NULL for a new pipe without a name), putting a
+// descriptor for its read end in fds[0], and for its write end in fds[1].
+
+int SysPipe(char *name, OpenFileId *fds)
+{
+  DescriptorTable *openFiles = kernel->currentThread->space->openFiles;
+  PipeBuffer *pipe = kernel->pipeTable->Open(name);
+
+  fds[0] = openFiles->AddPipe(pipe, FALSE);
+  if (fds[0] == -1)
+  {
+    kernel->pipeTable->Close(pipe, FALSE); // too many files open
+    kernel->pipeTable->Close(pipe, TRUE);
+    return -1;
+  }
+  fds[1] = openFiles->AddPipe(pipe, TRUE);
+  if (fds[1] == -1)
+  {
+    openFiles->Close(fds[0]);
+    kernel->pipeTable->Close(pipe, TRUE);
+    return -1;
+  }
+  return 1;
+}
+
+// Shared memory segments are kept by the kernel, by name; attaching
+// one maps its pages into the calling program's address space.
+
+int SysShmCreate(char *name, int size)
+{
+  return kernel->sharedMemory->Create(name, size) ? 1 : -1;
+}
+
+int SysShmAttach(char *name)
+{
+  SharedSegment *segment = kernel->sharedMemory->Attach(name);
+  int addr;
+
+  if (segment == NULL)
+    return -1;
+  addr = kernel->currentThread->space->Attach(segment);
+  if (addr == -1)
+    kernel->sharedMemory->Detach(segment); // no room for it
+  return addr;
+}
+
+int SysShmDetach(int addr)
+{
+  SharedSegment *segment = kernel->currentThread->space->Detach(addr);
+
+  if (segment == NULL)
+    return -1;
+  kernel->sharedMemory->Detach(segment);
+  return 1;
+}
+
+// A mapped file is opened afresh, and owned by the address space until
+// it is unmapped.
+
+int SysMmap(char *name)
+{
+  OpenFile *file = kernel->fileSystem->Open(name);
+  int addr;
+
+  if (file == NULL)
+    return -1;
+  addr = kernel->currentThread->space->Mmap(file);
+  if (addr == -1)
+    delete file; // empty, or no room
+  return addr;
+}
+
+int SysMunmap(int addr)
+{
+  return kernel->currentThread->space->Munmap(addr) ? 1 : -1;
+}
+
+int SysRemove(char *filename)
+{
+  // return value
+  // 1: success
+  // 0: failed
+  return kernel->fileSystem->Remove(filename);
 }
 
 #endif /* ! __USERPROG_KSYSCALL_H__ */
@@ -0,0 +1,267 @@
+// pipe.cc
+//	Routines to manage pipes between user programs.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "pipe.h"
+#include "debug.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------
+// PipeBuffer::PipeBuffer
+// 	Initialize an empty pipe.  No ends are open until OpenEnds.
+//
+//	"pipeName" -- the pipe's name, or NULL
+//----------------------------------------------------------------------
+
+PipeBuffer::PipeBuffer(char *pipeName)
+{
+  if (pipeName == NULL)
+    name = NULL;
+  else
+  {
+    name = new char[strlen(pipeName) + 1];
+    strcpy(name, pipeName);
+  }
+  buffer = new char[PipeSize];
+  head = count = 0;
+  readers = writers = 0;
+  lock = new Lock("pipe lock");
+  notEmpty = new Condition("pipe not empty");
+  notFull = new Condition("pipe not full");
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::~PipeBuffer
+// 	De-allocate a pipe; any bytes left in it are lost.
+//----------------------------------------------------------------------
+
+PipeBuffer::~PipeBuffer()
+{
+  delete [] name;
+  delete [] buffer;
+  delete lock;
+  delete notEmpty;
+  delete notFull;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Read
+// 	Wait until the pipe has something in it, then take as much as
+//	there is, up to "numBytes".  Return the number of bytes read,
+//	or 0 if the pipe is empty and no one can write to it any more.
+//
+//	"closed" -- set (followed by a WakeUp) if the read end the caller
+//		is reading from is closed meanwhile; the read then stops
+//		waiting, and returns 0
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Read(char *into, int numBytes, bool *closed)
+{
+  int done = 0, chunk;
+
+  lock->Acquire();
+  while (count == 0 && writers > 0 && !*closed)
+    notEmpty->Wait(lock);
+
+  // at most two copies: up to the end of the ring, then from the start
+  while (done < numBytes && count > 0)
+  {
+    chunk = min(numBytes - done, min(count, PipeSize - head));
+    bcopy(&buffer[head], &into[done], chunk);
+    head = (head + chunk) % PipeSize;
+    count -= chunk;
+    done += chunk;
+  }
+  if (done > 0)
+    notFull->Broadcast(lock);
+  lock->Release();
+  DEBUG(dbgSys, "Read " << done << " bytes from a pipe");
+  return done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::Write
+// 	Put "numBytes" bytes into the pipe, filling whatever room there
+//	is each time, and waiting for readers to make more.  Return the
+//	number of bytes written; that is less than "numBytes" (or -1, if
+//	nothing was written) only if the pipe has no name and every read
+//	end was closed.  A named pipe may yet be opened by a reader.
+//
+//	"closed" -- set (followed by a WakeUp) if the write end the caller
+//		is writing to is closed meanwhile; the write then stops
+//		waiting for room
+//----------------------------------------------------------------------
+
+int
+PipeBuffer::Write(char *from, int numBytes, bool *closed)
+{
+  int done = 0, tail, chunk;
+
+  lock->Acquire();
+  while (done < numBytes && (readers > 0 || name != NULL) && !*closed)
+  {
+    if (count == PipeSize)
+    {
+      notFull->Wait(lock);
+      continue;
+    }
+    while (done < numBytes && count < PipeSize)
+    {
+      tail = (head + count) % PipeSize;
+      chunk = min(numBytes - done, min(PipeSize - count, PipeSize - tail));
+      bcopy(&from[done], &buffer[tail], chunk);
+      count += chunk;
+      done += chunk;
+    }
+    notEmpty->Broadcast(lock);
+  }
+  lock->Release();
+  DEBUG(dbgSys, "Wrote " << done << " bytes to a pipe");
+  return (done == 0 && numBytes > 0) ? -1 : done;
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::WakeUp
+// 	Wake up every thread waiting to read or write the pipe, so that
+//	one whose end has been closed sees it, and stops waiting.  The
+//	others go back to sleep.
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::WakeUp()
+{
+  lock->Acquire();
+  notEmpty->Broadcast(lock);
+  notFull->Broadcast(lock);
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::OpenEnds
+// 	Note that a program has opened a read end and a write end.
+//----------------------------------------------------------------------
+
+void
+PipeBuffer::OpenEnds()
+{
+  lock->Acquire();
+  readers++;
+  writers++;
+  lock->Release();
+}
+
+//----------------------------------------------------------------------
+// PipeBuffer::CloseEnd
+// 	Note that a read end (or a write end) was closed, and wake up
+//	anyone waiting for the other end, in case it was the last one.
+//	Return TRUE if no ends are left open, and the pipe has no name
+//	or nothing left in it for a program that opens it later.
+//----------------------------------------------------------------------
+
+bool
+PipeBuffer::CloseEnd(bool writeEnd)
+{
+  bool unused;
+
+  lock->Acquire();
+  if (writeEnd)
+  {
+    ASSERT(writers > 0);
+    writers--;
+    notEmpty->Broadcast(lock);
+  }
+  else
+  {
+    ASSERT(readers > 0);
+    readers--;
+    notFull->Broadcast(lock);
+  }
+  unused = (readers == 0 && writers == 0 && (name == NULL || count == 0));
+  lock->Release();
+  return unused;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::PipeTable
+// 	Initialize an empty table of named pipes.
+//----------------------------------------------------------------------
+
+PipeTable::PipeTable()
+{
+  pipes = new List<PipeBuffer *>;
+  lock = new Lock("pipe table lock");
+}
+
+//----------------------------------------------------------------------
+// PipeTable::~PipeTable
+// 	De-allocate the table, at shutdown, with the pipes in it.
+//----------------------------------------------------------------------
+
+PipeTable::~PipeTable()
+{
+  while (!pipes->IsEmpty())
+    delete pipes->RemoveFront();
+  delete pipes;
+  delete lock;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Open
+// 	Return the pipe named "name", with one more read end and one
+//	more write end open.  If there is no such pipe, or "name" is
+//	NULL, make a new one.
+//----------------------------------------------------------------------
+
+PipeBuffer *
+PipeTable::Open(char *name)
+{
+  PipeBuffer *pipe = NULL;
+
+  lock->Acquire();
+  if (name != NULL)
+  {
+    ListIterator<PipeBuffer *> iter(pipes);
+
+    for (; !iter.IsDone(); iter.Next())
+      if (strcmp(iter.Item()->Name(), name) == 0)
+      {
+        pipe = iter.Item();
+        break;
+      }
+  }
+  if (pipe == NULL)
+  {
+    DEBUG(dbgSys, "Making pipe " << (name != NULL ? name : "(no name)"));
+    pipe = new PipeBuffer(name);
+    if (name != NULL)
+      pipes->Append(pipe);
+  }
+  pipe->OpenEnds();
+  lock->Release();
+  return pipe;
+}
+
+//----------------------------------------------------------------------
+// PipeTable::Close
+// 	Close one end of "pipe".  If the pipe is no longer needed, take
+//	it out of the table and delete it.
+//----------------------------------------------------------------------
+
+void
+PipeTable::Close(PipeBuffer *pipe, bool writeEnd)
+{
+  lock->Acquire();
+  if (pipe->CloseEnd(writeEnd))
+  {
+    if (pipe->Name() != NULL)
+      pipes->Remove(pipe);
+    delete pipe;
+  }
+  lock->Release();
+}
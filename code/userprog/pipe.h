@@ -0,0 +1,106 @@
+// pipe.h
+//	Data structures for pipes between user programs.
+//
+//	A pipe is a buffer in the kernel, with a read end and a write
+//	end.  Bytes written to the write end can be read, in the same
+//	order, from the read end.  A reader waits while the pipe is
+//	empty, and a writer while it is full; each wakeup moves as many
+//	bytes as there are (or as there is room for), not one at a time.
+//
+//	Programs started by Kernel::Exec share nothing, so pipes have
+//	names: every program that opens the pipe with the same name gets
+//	its own read and write descriptors for the same buffer.  A pipe
+//	without a name can only be used by the program that made it.
+//	The pipe goes away when every end of it is closed -- except that
+//	a named pipe with bytes still in it is kept, so that a writer
+//	that finishes before its reader has opened the pipe doesn't take
+//	the bytes with it.
+//
+//	A read returns 0 (end of file) once the pipe is empty and no
+//	write end is open -- including the reader's own, so a program
+//	that reads until end of file must first close its write end.
+//	A write to a pipe without a name fails once no read end is open;
+//	a named pipe can still be opened by another program, so a write
+//	to it waits for room as usual.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "copyright.h"
+#include "list.h"
+#include "synch.h"
+
+#define PipeSize	1024	// bytes a pipe can hold
+
+// The following class defines one pipe.  (It isn't called Pipe, since
+// that is the name of the system call, in syscall.h.)
+
+class PipeBuffer {
+  public:
+    PipeBuffer(char *name);		// Initialize an empty pipe with
+					// no ends open
+    ~PipeBuffer();			// De-allocate the pipe
+
+    char *Name() { return name; }	// The pipe's name, or NULL
+
+    int Read(char *into, int numBytes, bool *closed);
+					// Wait for some bytes, and read up
+					// to "numBytes" of them; return 0
+					// at end of file
+    int Write(char *from, int numBytes, bool *closed);
+					// Write all "numBytes", waiting
+					// for room as needed; return -1
+					// if no one will ever read them
+					// (Either gives up waiting once
+					// "*closed" is set; see WakeUp)
+    void WakeUp();			// Make waiting readers and writers
+					// look at "*closed" again
+
+    void OpenEnds();			// A program opened both ends
+    bool CloseEnd(bool writeEnd);	// Close one end; return TRUE if
+					// the pipe is no longer needed
+
+  private:
+    char *name;				// NULL if the pipe has no name
+    char *buffer;			// The bytes in the pipe, a ring
+					// of PipeSize bytes
+    int head;				// Where the oldest byte is
+    int count;				// How many bytes there are
+    int readers;			// Read ends open
+    int writers;			// Write ends open
+
+    Lock *lock;				// Protects all of the above
+    Condition *notEmpty;		// Signalled when bytes arrive, or
+					// the last writer goes away
+    Condition *notFull;			// Signalled when bytes are taken,
+					// or the last reader goes away
+};
+
+// The following class defines the table of named pipes, kept by the
+// kernel.
+
+class PipeTable {
+  public:
+    PipeTable();			// Initialize an empty table
+    ~PipeTable();			// De-allocate the table, and any
+					// pipes still in it
+
+    PipeBuffer *Open(char *name);	// Open both ends of the pipe
+					// "name", making it if it doesn't
+					// exist; NULL makes a new pipe
+    void Close(PipeBuffer *pipe, bool writeEnd);
+					// Close one end of a pipe returned
+					// by Open, deleting the pipe once
+					// it is no longer needed
+
+  private:
+    List<PipeBuffer *> *pipes;	// Named pipes with ends open, or
+					// bytes not yet read
+    Lock *lock;				// Protects "pipes"
+};
+
+#endif // PIPE_H
@@ -0,0 +1,158 @@
+// shm.cc
+//	Routines to manage shared memory segments.
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "shm.h"
+#include "main.h"
+#include "bitmap.h"
+
+#include <string.h>
+
+//----------------------------------------------------------------------
+// SharedSegment::SharedSegment
+// 	Initialize a segment, not yet attached to any program.
+//
+//	"segmentName" -- the segment's name
+//	"pages" -- how many pages it has
+//	"pageFrames" -- the physical page for each, taken from
+//		kernel->frameMap
+//----------------------------------------------------------------------
+
+SharedSegment::SharedSegment(char *segmentName, int pages, int *pageFrames)
+{
+  name = new char[strlen(segmentName) + 1];
+  strcpy(name, segmentName);
+  numPages = pages;
+  frames = pageFrames;
+  refCount = 0;
+}
+
+//----------------------------------------------------------------------
+// SharedSegment::~SharedSegment
+// 	Give the segment's physical pages back to the kernel.
+//----------------------------------------------------------------------
+
+SharedSegment::~SharedSegment()
+{
+  for (int i = 0; i < numPages; i++)
+    kernel->frameMap->Clear(frames[i]);
+  delete [] frames;
+  delete [] name;
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::SharedMemoryTable
+// 	Initialize an empty table of segments.
+//----------------------------------------------------------------------
+
+SharedMemoryTable::SharedMemoryTable()
+{
+  segments = new List<SharedSegment *>;
+  lock = new Lock("shared memory lock");
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::~SharedMemoryTable
+// 	De-allocate the table, at shutdown, with the segments in it.
+//----------------------------------------------------------------------
+
+SharedMemoryTable::~SharedMemoryTable()
+{
+  while (!segments->IsEmpty())
+    delete segments->RemoveFront();
+  delete segments;
+  delete lock;
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::Find
+// 	Return the segment named "name", or NULL if there isn't one.
+//	The caller must hold the lock.
+//----------------------------------------------------------------------
+
+SharedSegment *
+SharedMemoryTable::Find(char *name)
+{
+  ListIterator<SharedSegment *> iter(segments);
+
+  for (; !iter.IsDone(); iter.Next())
+    if (strcmp(iter.Item()->name, name) == 0)
+      return iter.Item();
+  return NULL;
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::Create
+// 	Make a segment named "name", big enough for "size" bytes, out of
+//	free physical pages filled with zeros.  Return FALSE if there is
+//	already a segment with that name, or not enough free memory.
+//----------------------------------------------------------------------
+
+bool
+SharedMemoryTable::Create(char *name, int size)
+{
+  int numPages = divRoundUp(size, PageSize);
+  int *frames;
+  bool success = FALSE;
+
+  if (size <= 0)
+    return FALSE;
+  lock->Acquire();
+  if (Find(name) == NULL && kernel->frameMap->NumClear() >= numPages)
+  {
+    frames = new int[numPages];
+    for (int i = 0; i < numPages; i++)
+    {
+      frames[i] = kernel->frameMap->FindAndSet();
+      bzero(&kernel->machine->mainMemory[frames[i] * PageSize], PageSize);
+    }
+    segments->Append(new SharedSegment(name, numPages, frames));
+    DEBUG(dbgAddr, "Shared memory " << name << ": " << numPages << " pages");
+    success = TRUE;
+  }
+  lock->Release();
+  return success;
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::Attach
+// 	Return the segment named "name", counting one more program that
+//	has it attached; NULL if there is no such segment.
+//----------------------------------------------------------------------
+
+SharedSegment *
+SharedMemoryTable::Attach(char *name)
+{
+  SharedSegment *segment;
+
+  lock->Acquire();
+  segment = Find(name);
+  if (segment != NULL)
+    segment->refCount++;
+  lock->Release();
+  return segment;
+}
+
+//----------------------------------------------------------------------
+// SharedMemoryTable::Detach
+// 	Give back a segment returned by Attach.  If no program has it
+//	attached any more, delete it, giving back its memory.
+//----------------------------------------------------------------------
+
+void
+SharedMemoryTable::Detach(SharedSegment *segment)
+{
+  lock->Acquire();
+  ASSERT(segment->refCount > 0);
+  if (--segment->refCount == 0)
+  {
+    DEBUG(dbgAddr, "Shared memory " << segment->name << " deleted");
+    segments->Remove(segment);
+    delete segment;
+  }
+  lock->Release();
+}
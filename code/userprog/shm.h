@@ -0,0 +1,64 @@
+// shm.h
+//	Data structures for shared memory segments between user programs.
+//
+//	A shared memory segment is a set of physical pages, with a name.
+//	A program that attaches the segment gets its pages mapped into
+//	its address space (see AddrSpace::Attach); every program that
+//	attaches it maps the same physical pages, so what one writes the
+//	others see at once, with no copying through the kernel.
+//
+//	A new segment is filled with zeros.  It lasts until it has been
+//	attached, and then detached by every program that attached it
+//	(a program that exits detaches everything it had attached).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SHM_H
+#define SHM_H
+
+#include "copyright.h"
+#include "list.h"
+#include "synch.h"
+
+// The following class defines one shared memory segment.
+
+class SharedSegment {
+  public:
+    SharedSegment(char *name, int numPages, int *frames);
+					// Initialize a segment made of
+					// "frames", which it now owns
+    ~SharedSegment();			// Give the frames back
+
+    char *name;				// The segment's name
+    int numPages;			// How many pages it has
+    int *frames;			// The physical page of each
+    int refCount;			// Programs it is attached to
+};
+
+// The following class defines the table of shared memory segments,
+// kept by the kernel.
+
+class SharedMemoryTable {
+  public:
+    SharedMemoryTable();		// Initialize an empty table
+    ~SharedMemoryTable();		// De-allocate the table, and the
+					// segments in it
+
+    bool Create(char *name, int size);	// Make a segment named "name" of
+					// "size" bytes; return FALSE if
+					// there is one, or no memory
+    SharedSegment *Attach(char *name);	// Return the segment "name", one
+					// more time attached; or NULL
+    void Detach(SharedSegment *segment);// Undo Attach, deleting the
+					// segment once no one has it
+
+  private:
+    List<SharedSegment *> *segments;	// The segments, in no order
+    Lock *lock;				// Protects "segments"
+
+    SharedSegment *Find(char *name);	// The segment "name", or NULL
+};
+
+#endif // SHM_H
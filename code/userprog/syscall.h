@@ -35,6 +35,20 @@
 #define SC_ThreadExit 14
 #define SC_ThreadJoin 15
 #define SC_PrintInt 16
+#define SC_RingSetup 17
+#define SC_RingEnter 18
+#define SC_Sbrk 19
+#define SC_Pipe 20
+#define SC_ShmCreate 21
+#define SC_ShmAttach 22
+#define SC_ShmDetach 23
+#define SC_FutexWait 24
+#define SC_FutexWake 25
+#define SC_Mmap 26
+#define SC_Munmap 27
+#define SC_Sleep 28
+#define SC_GetTicks 29
+#define SC_GetPerfCounters 30
 #define SC_Add 42
 #define SC_MSG 100
 #ifndef IN_ASM
@@ -149,6 +163,17 @@ int Seek(int position, OpenFileId id);
  */
 int Close(OpenFileId id);
 
+/* Open the pipe named "name", making it if no program has it open,
+ * and put a descriptor for its read end in fds[0], and for its write
+ * end in fds[1].  Every program that opens the same name gets the same
+ * pipe; if "name" is 0, the pipe is new, and has no name.  Read returns
+ * whatever is in the pipe (waiting until there is something), or 0
+ * once the pipe is empty and every write end is closed; Write waits
+ * for room.  Close each end when done with it.
+ * Return 1 on success, -1 on failure.
+ */
+int Pipe(char *name, OpenFileId fds[2]);
+
 /* User-level thread operations: Fork and Yield.  To allow multiple
  * threads to run within a user program. 
  *
@@ -177,6 +202,145 @@ int ThreadJoin(ThreadId id);
  */
 void ThreadExit(int ExitCode);
 
+/* Let other threads run, without using the CPU, until at least "ticks"
+ * ticks of simulated time have gone by.  The thread is woken up by the
+ * first timer interrupt after that.
+ */
+void Sleep(int ticks);
+
+/* Performance counters, so that a program can time the phases of its
+ * own work: call GetTicks (or GetPerfCounters) before and after, and
+ * subtract.
+ */
+
+/* Return the simulated time, in ticks, since Nachos started. */
+int GetTicks();
+
+typedef struct {
+    int totalTicks;		/* simulated time, as GetTicks returns */
+    int userTicks;		/* time this thread spent in user code */
+    int systemTicks;		/* and in the kernel */
+    int pageFaults;		/* pages of mapped files read in */
+    int diskReads;		/* disk read requests made */
+    int syscalls;		/* system calls made, this one included */
+} PerfCounters;
+
+/* Fill in "counters" -- the counts are for this program, and the time
+ * for the calling thread.  Return 1 on success, -1 on failure.
+ */
+int GetPerfCounters(PerfCounters *counters);
+
+/* Move the end of the program's heap by "increment" bytes (which may
+ * be negative), and return the old end.  The memory added is zeroed.
+ * Return (void *) -1 if there isn't enough memory.  User programs
+ * normally use malloc and free (see test/umalloc.h) instead.
+ */
+void *Sbrk(int increment);
+
+/* Shared memory: pages that several programs have in their address
+ * spaces at once, so that what one writes the others see, without
+ * going through Write and Read.
+ */
+
+/* Make a shared memory segment named "name", of "size" bytes, filled
+ * with zeros.  It lasts until every program that attaches it has
+ * detached it.  Return 1 on success, -1 if there is already a segment
+ * with that name, or not enough memory.
+ */
+int ShmCreate(char *name, int size);
+
+/* Map the segment "name" into this program's address space, and
+ * return its address; return (void *) -1 if there is no such segment,
+ * or no room for it.
+ */
+void *ShmAttach(char *name);
+
+/* Unmap the segment at "addr", as returned by ShmAttach.  A program
+ * that exits detaches every segment it has attached.
+ * Return 1 on success, -1 on failure.
+ */
+int ShmDetach(void *addr);
+
+/* Futexes: waiting for a word in memory to change, without spinning.
+ * A program keeps the state of a lock (or flag, or counter) in a word,
+ * in its own memory or in shared memory, and only traps when it has to
+ * wait for another thread or program to change it.
+ */
+
+/* If the word at "addr" holds "expected", sleep until FutexWake is
+ * called on it (by any program, at whatever address it has the word).
+ * Return 1 once woken, 0 at once if the word holds something else,
+ * or -1 if "addr" isn't the address of a word.
+ */
+int FutexWait(int *addr, int expected);
+
+/* Wake up to "count" of the threads sleeping on the word at "addr".
+ * Return how many were woken, or -1 if "addr" is bad.
+ */
+int FutexWake(int *addr, int count);
+
+/* Map the Nachos file "name" into this program's address space, and
+ * return the address of its first byte; return (void *) -1 if there
+ * is no such file, it is empty, or there is no room for it.  Each page
+ * is read from the file when it is first touched, and pages that were
+ * changed are written back to the file by Munmap (or when the program
+ * exits).  The file doesn't grow: writing past its end is lost.
+ */
+void *Mmap(char *name);
+
+/* Unmap the file mapped at "addr", as returned by Mmap, writing back
+ * the changes.  Return 1 on success, -1 on failure.
+ */
+int Munmap(void *addr);
+
+/* System call rings: a way to make many file system calls with a
+ * single trap.  The program sets aside a SyscallRing in its own memory
+ * and registers it with RingSetup.  To make calls, it fills in entries
+ * in the submission ring (each names a system call -- Create, Remove,
+ * Open, Read, Write, Seek or Close -- and its arguments), advances
+ * submitTail, and calls RingEnter.  A kernel thread makes the calls in
+ * order, and puts each result in the completion ring, advancing
+ * completeTail; the program reaps results by advancing completeHead.
+ *
+ * The indices count up forever; entry i is in slot i % RingEntries.
+ * The program only writes submitTail and completeHead, the kernel only
+ * submitHead and completeTail.  The kernel stops taking submissions
+ * while the completion ring is full.
+ */
+
+#define RingEntries 16
+
+typedef struct {
+    int type;			/* SC_Read, SC_Write, ... */
+    int arg1, arg2, arg3;	/* its arguments, as for the call itself */
+    int userData;		/* passed back in the completion */
+} RingSubmission;
+
+typedef struct {
+    int result;			/* what the call returned */
+    int userData;		/* from the submission */
+} RingCompletion;
+
+typedef struct {
+    int submitHead;		/* next submission the kernel will take */
+    int submitTail;		/* next free submission slot */
+    int completeHead;		/* next completion the program will reap */
+    int completeTail;		/* next free completion slot */
+    RingSubmission submissions[RingEntries];
+    RingCompletion completions[RingEntries];
+} SyscallRing;
+
+/* Register "ring" as this program's system call ring, and start the
+ * kernel thread that serves it.  Return 1 on success, -1 on failure.
+ */
+int RingSetup(SyscallRing *ring);
+
+/* Tell the kernel there are new submissions (or reaped completions),
+ * and wait until at least "minComplete" completions are ready to be
+ * reaped, or nothing more is outstanding.  Return the number ready.
+ */
+int RingEnter(int minComplete);
+
 #endif /* IN_ASM */
 
 #endif /* SYSCALL_H */
@@ -0,0 +1,754 @@
+// fsck.cc
+//	Check the file system on a Nachos disk, and optionally repair it.
+//	This runs on the host, not under Nachos; the disk is just the
+//	UNIX file that the Nachos disk is simulated in (e.g., DISK_0).
+//
+//	The checker does what Nachos would do when mounting the disk --
+//	if the log holds a committed operation, that is written home
+//	first -- and then:
+//
+//	   walks the tree of directories, starting at the root, and
+//	      checks every file header it finds, along with the indirect
+//	      blocks it points to;
+//	   notes which file each sector belongs to, so that a sector
+//	      used by two files is caught;
+//	   compares what it found with the bitmap of free sectors,
+//	      reporting sectors in use but marked free, and sectors
+//	      marked in use that nothing points to ("leaked").
+//
+//	The headers are checked by several host threads at once.  They
+//	share a queue of headers waiting to be checked; checking a
+//	directory adds each of its entries to the queue.
+//
+//	With -r, the checker repairs what it can: it removes directory
+//	entries that point to headers that make no sense (the files'
+//	sectors then count as leaked), and rewrites the bitmap to match
+//	the sectors actually in use.  A sector used by two files is only
+//	reported; there is no telling which file it belongs to.
+//
+//	The layout of the disk and of the file system's data structures
+//	must agree with machine/disk.cc, filesys/filehdr.h,
+//	filesys/directory.h, filesys/journal.h and filesys/filesys.cc.
+//	Only a single disk can be checked; a volume striped across several
+//	disks can't (each disk of a mirrored one can be checked by itself).
+//
+// Copyright (c) 1992-1996 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+// The disk (machine/disk.cc)
+const int SectorSize = 128;
+const int MagicNumber = 0x456789ac;	// followed by the geometry
+const int OldMagicNumber = 0x456789ab;	// 32 tracks of 32 sectors
+const int DefaultSectorsPerTrack = 32;
+const int DefaultNumTracks = 32;
+
+// File headers (filesys/filehdr.h)
+const int NumIndirect = SectorSize / sizeof(int);
+const int NumDirect = (SectorSize - 4 * sizeof(int)) / sizeof(int);
+const int MaxFileSectors = NumDirect + NumIndirect + NumIndirect * NumIndirect;
+
+class FileHeader {
+  public:
+    int numBytes;
+    int numSectors;
+    int dataSectors[NumDirect];
+    int indirectSector;
+    int doubleIndirectSector;
+};
+
+// Directories (filesys/directory.h)
+const int FileNameMaxLen = 59;
+
+class DirectoryEntry {
+  public:
+    bool inUse;
+    bool isDirectory;
+    bool deleted;
+    int sector;
+    char name[FileNameMaxLen + 1];
+};
+
+// The log (filesys/journal.h)
+const int LogMagic = 0x4c4f4721;
+const int NumLogEntries = SectorSize / sizeof(int) - 2;
+
+class LogHeader {
+  public:
+    int magic;
+    int numEntries;
+    int sectors[NumLogEntries];
+};
+
+// Where things are (filesys/filesys.cc)
+const int FreeMapSector = 0;
+const int DirectorySector = 1;
+const int LogSector = 2;
+const int LogSectors = 1 + NumLogEntries;
+const int BitsInWord = 32;
+
+// What the checker knows about each sector
+const int Unused = -1;			// nothing points to it
+const int Reserved = -2;		// the log
+
+#define divRoundUp(n,s)    (((n) / (s)) + ((((n) % (s)) > 0) ? 1 : 0))
+
+// A file header waiting to be checked, and where its name is
+
+class Job {
+  public:
+    int sector;				// Where the header is
+    bool isDirectory;			// Is the file a directory?
+    char *path;				// Full name, for messages
+    int parentSector;			// Header of its directory, or -1
+    int entryIndex;			// Its entry in that directory
+    Job *next;
+};
+
+// The state of the check, shared by all the threads
+
+static char *diskName;
+static int diskFile;
+static char *image;			// the whole disk, in memory
+static int headerSize;			// bytes in the UNIX file before
+					// sector 0
+static int numSectors;
+static bool *dirty;			// sectors changed by repairs
+static int *owner;			// for each sector, the header of the
+					// file using it, Unused or Reserved
+
+static bool repair = false;
+static bool verbose = false;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t moreWork = PTHREAD_COND_INITIALIZER;
+static Job *queue = NULL;		// headers waiting to be checked
+static int pending = 0;			// headers queued or being checked
+static Job *dropped = NULL;		// entries to remove, if repairing
+static int numProblems = 0;
+static int numUnrepairable = 0;	// problems -r can't fix
+static int numFiles = 0, numDirectories = 0;
+
+//----------------------------------------------------------------------
+// Problem
+// 	Report something wrong with the file system.
+//----------------------------------------------------------------------
+
+static void
+Problem(const char *format, ...)
+{
+    va_list ap;
+
+    pthread_mutex_lock(&mutex);
+    numProblems++;
+    va_start(ap, format);
+    vprintf(format, ap);
+    va_end(ap);
+    printf("\n");
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// Sector
+// 	Return where sector "s" of the disk is, in memory.
+//----------------------------------------------------------------------
+
+static char *
+Sector(int s)
+{
+    return &image[s * SectorSize];
+}
+
+static bool
+InRange(int s)
+{
+    return (s >= 0) && (s < numSectors);
+}
+
+//----------------------------------------------------------------------
+// LoadDisk
+// 	Read the whole disk into memory, after checking its magic
+//	number and finding out its geometry.  Return false if it isn't
+//	a Nachos disk.
+//----------------------------------------------------------------------
+
+static bool
+LoadDisk()
+{
+    int header[3];
+    int sectorsPerTrack, numTracks;
+    off_t size;
+
+    diskFile = open(diskName, repair ? O_RDWR : O_RDONLY);
+    if (diskFile < 0) {
+	perror(diskName);
+	return false;
+    }
+    if (read(diskFile, header, sizeof(header)) != sizeof(header)) {
+	fprintf(stderr, "%s: too short to be a Nachos disk\n", diskName);
+	return false;
+    }
+    if (header[0] == OldMagicNumber) {
+	headerSize = sizeof(int);
+	sectorsPerTrack = DefaultSectorsPerTrack;
+	numTracks = DefaultNumTracks;
+    } else if (header[0] == MagicNumber) {
+	headerSize = 3 * sizeof(int);
+	sectorsPerTrack = header[1];
+	numTracks = header[2];
+    } else {
+	fprintf(stderr, "%s: not a Nachos disk\n", diskName);
+	return false;
+    }
+    numSectors = sectorsPerTrack * numTracks;
+    size = (off_t) numSectors * SectorSize;
+    if (numSectors <= LogSector + LogSectors) {
+	fprintf(stderr, "%s: disk is too small\n", diskName);
+	return false;
+    }
+
+    image = new char[size];
+    if (pread(diskFile, image, size, headerSize) != size) {
+	fprintf(stderr, "%s: disk is shorter than its geometry says\n",
+								diskName);
+	return false;
+    }
+    dirty = new bool[numSectors];
+    owner = new int[numSectors];
+    for (int i = 0; i < numSectors; i++) {
+	dirty[i] = false;
+	owner[i] = Unused;
+    }
+    if (verbose)
+	printf("%s: %d tracks of %d sectors\n", diskName, numTracks,
+							sectorsPerTrack);
+    return true;
+}
+
+//----------------------------------------------------------------------
+// SaveDisk
+// 	Write the sectors changed by repairs back to the disk.
+//----------------------------------------------------------------------
+
+static void
+SaveDisk()
+{
+    for (int i = 0; i < numSectors; i++)
+	if (dirty[i] && pwrite(diskFile, Sector(i), SectorSize,
+			headerSize + (off_t) i * SectorSize) != SectorSize)
+	    perror(diskName);
+}
+
+//----------------------------------------------------------------------
+// ReplayLog
+// 	If the log holds an operation that was committed, but maybe not
+//	written home, write it home now, as mounting the disk would.
+//----------------------------------------------------------------------
+
+static void
+ReplayLog()
+{
+    LogHeader *log = (LogHeader *) Sector(LogSector);
+
+    for (int i = 0; i < LogSectors; i++)
+	owner[LogSector + i] = Reserved;
+    if (log->magic != LogMagic) {
+	if (verbose)
+	    printf("No log on the disk\n");
+	return;
+    }
+    if (log->numEntries == 0)
+	return;
+    if ((log->numEntries < 0) || (log->numEntries > NumLogEntries)) {
+	Problem("Log header is garbled (%d entries)", log->numEntries);
+	return;
+    }
+    for (int i = 0; i < log->numEntries; i++)
+	if (!InRange(log->sectors[i])) {
+	    Problem("Log entry %d is for sector %d, off the disk", i,
+							log->sectors[i]);
+	    return;
+	}
+    printf("Replaying %d sectors from the log\n", log->numEntries);
+    for (int i = 0; i < log->numEntries; i++) {
+	memcpy(Sector(log->sectors[i]), Sector(LogSector + 1 + i), SectorSize);
+	dirty[log->sectors[i]] = true;
+    }
+    log->numEntries = 0;
+    dirty[LogSector] = true;
+}
+
+//----------------------------------------------------------------------
+// DataSectors
+// 	Find every sector used by the file with header "hdr" -- its data
+//	blocks, followed by its indirect blocks -- and store them in
+//	"sectors", which must have room for MaxFileSectors + NumIndirect
+//	+ 2 of them.  Return how many there are, or -1 (with "why" saying
+//	what is wrong) if the header doesn't make sense.
+//----------------------------------------------------------------------
+
+static int
+DataSectors(FileHeader *hdr, int *sectors, const char **why)
+{
+    int n = 0, numIndex = 0;
+    int index[NumIndirect + 2];
+    int *indirect, *doubleIndirect;
+
+    if ((hdr->numBytes < 0) || (hdr->numSectors < 0)
+		|| (hdr->numSectors > MaxFileSectors)
+		|| (hdr->numSectors != divRoundUp(hdr->numBytes, SectorSize))) {
+	*why = "its length makes no sense";
+	return -1;
+    }
+    for (int i = 0; (i < hdr->numSectors) && (i < NumDirect); i++)
+	sectors[n++] = hdr->dataSectors[i];
+
+    if (hdr->numSectors > NumDirect) {
+	if (!InRange(hdr->indirectSector)) {
+	    *why = "its indirect block is off the disk";
+	    return -1;
+	}
+	index[numIndex++] = hdr->indirectSector;
+	indirect = (int *) Sector(hdr->indirectSector);
+	for (int i = NumDirect;
+		(i < hdr->numSectors) && (i < NumDirect + NumIndirect); i++)
+	    sectors[n++] = indirect[i - NumDirect];
+    }
+
+    if (hdr->numSectors > NumDirect + NumIndirect) {
+	int left = hdr->numSectors - NumDirect - NumIndirect;
+
+	if (!InRange(hdr->doubleIndirectSector)) {
+	    *why = "its doubly indirect block is off the disk";
+	    return -1;
+	}
+	index[numIndex++] = hdr->doubleIndirectSector;
+	doubleIndirect = (int *) Sector(hdr->doubleIndirectSector);
+	for (int k = 0; left > 0; k++) {
+	    if (!InRange(doubleIndirect[k])) {
+		*why = "one of its indirect blocks is off the disk";
+		return -1;
+	    }
+	    index[numIndex++] = doubleIndirect[k];
+	    indirect = (int *) Sector(doubleIndirect[k]);
+	    for (int i = 0; (i < NumIndirect) && (left > 0); i++, left--)
+		sectors[n++] = indirect[i];
+	}
+    }
+
+    for (int i = 0; i < n; i++)
+	if (!InRange(sectors[i])) {
+	    *why = "one of its data blocks is off the disk";
+	    return -1;
+	}
+    for (int i = 0; i < numIndex; i++)
+	sectors[n++] = index[i];
+    return n;
+}
+
+//----------------------------------------------------------------------
+// FileSector
+// 	Return the sector holding byte "offset" of the file with header
+//	"hdr".  The header must already have been checked.
+//----------------------------------------------------------------------
+
+static int
+FileSector(FileHeader *hdr, int offset)
+{
+    int i = offset / SectorSize;
+
+    if (i < NumDirect)
+	return hdr->dataSectors[i];
+    i -= NumDirect;
+    if (i < NumIndirect)
+	return ((int *) Sector(hdr->indirectSector))[i];
+    i -= NumIndirect;
+    int *doubleIndirect = (int *) Sector(hdr->doubleIndirectSector);
+    return ((int *) Sector(doubleIndirect[i / NumIndirect]))[i % NumIndirect];
+}
+
+//----------------------------------------------------------------------
+// FileBytes
+// 	Copy "numBytes" bytes at "offset" in the file with header "hdr"
+//	to/from "buffer".  When writing, the changed sectors are marked
+//	to be written back to the disk.
+//----------------------------------------------------------------------
+
+static void
+FileBytes(FileHeader *hdr, int offset, char *buffer, int numBytes,
+		bool writing)
+{
+    while (numBytes > 0) {
+	int sector = FileSector(hdr, offset);
+	int start = offset % SectorSize;
+	int n = SectorSize - start;
+
+	if (n > numBytes)
+	    n = numBytes;
+	if (writing) {
+	    memcpy(Sector(sector) + start, buffer, n);
+	    dirty[sector] = true;
+	} else {
+	    memcpy(buffer, Sector(sector) + start, n);
+	}
+	offset += n;
+	buffer += n;
+	numBytes -= n;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddJob
+// 	Queue a header to be checked.
+//----------------------------------------------------------------------
+
+static void
+AddJob(int sector, bool isDirectory, char *path, int parentSector,
+		int entryIndex)
+{
+    Job *job = new Job;
+
+    job->sector = sector;
+    job->isDirectory = isDirectory;
+    job->path = path;
+    job->parentSector = parentSector;
+    job->entryIndex = entryIndex;
+    pthread_mutex_lock(&mutex);
+    job->next = queue;
+    queue = job;
+    pending++;
+    pthread_cond_signal(&moreWork);
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// Drop
+// 	The header named by "job" is no good; if repairing, remember to
+//	remove its entry from its directory once all the threads are done.
+//	Takes over "job".
+//----------------------------------------------------------------------
+
+static void
+Drop(Job *job)
+{
+    if (!repair || job->parentSector == -1) {
+	delete [] job->path;
+	delete job;
+	return;
+    }
+    pthread_mutex_lock(&mutex);
+    job->next = dropped;
+    dropped = job;
+    pthread_mutex_unlock(&mutex);
+}
+
+//----------------------------------------------------------------------
+// Claim
+// 	Note that "sector" is used by the file whose header is at "hdr".
+//	Return false if some other file already uses it.
+//----------------------------------------------------------------------
+
+static bool
+Claim(int sector, int hdr)
+{
+    return __sync_bool_compare_and_swap(&owner[sector], Unused, hdr);
+}
+
+//----------------------------------------------------------------------
+// CheckDirectory
+// 	Queue each entry in the directory whose header is "hdr".
+//----------------------------------------------------------------------
+
+static void
+CheckDirectory(Job *job, FileHeader *hdr)
+{
+    int numEntries = hdr->numBytes / sizeof(DirectoryEntry);
+    DirectoryEntry entry;
+
+    for (int i = 0; i < numEntries; i++) {
+	FileBytes(hdr, i * sizeof(DirectoryEntry), (char *) &entry,
+			sizeof(DirectoryEntry), false);
+	if (!entry.inUse)
+	    continue;
+	if (memchr(entry.name, '\0', FileNameMaxLen + 1) == NULL) {
+	    Problem("%s: entry %d has an unterminated name", job->path, i);
+	    entry.name[FileNameMaxLen] = '\0';
+	}
+
+	char *path = new char[strlen(job->path) + strlen(entry.name) + 2];
+	sprintf(path, "%s%s%s", job->path,
+		(job->path[strlen(job->path) - 1] == '/') ? "" : "/",
+		entry.name);
+	AddJob(entry.sector, entry.isDirectory, path, job->sector, i);
+    }
+}
+
+//----------------------------------------------------------------------
+// CheckFile
+// 	Check one file header, and the sectors it points to.
+//----------------------------------------------------------------------
+
+static void
+CheckFile(Job *job)
+{
+    FileHeader hdr;
+    int *sectors = new int[MaxFileSectors + NumIndirect + 2];
+    const char *why;
+    int n;
+
+    if (!InRange(job->sector)) {
+	Problem("%s: header sector %d is off the disk", job->path,
+								job->sector);
+	Drop(job);
+	delete [] sectors;
+	return;
+    }
+    memcpy(&hdr, Sector(job->sector), sizeof(hdr));
+    n = DataSectors(&hdr, sectors, &why);
+    if (n < 0) {
+	Problem("%s: bad header at sector %d: %s", job->path, job->sector,
+									why);
+	Drop(job);
+	delete [] sectors;
+	return;
+    }
+    if (!Claim(job->sector, job->sector)) {
+	// the same header is in two directories, or a directory is
+	// inside itself; don't look at it twice
+	Problem("%s: header at sector %d is already used by the file "
+		"whose header is at %d", job->path, job->sector,
+		owner[job->sector]);
+	Drop(job);
+	delete [] sectors;
+	return;
+    }
+    for (int i = 0; i < n; i++)
+	if (!Claim(sectors[i], job->sector)) {
+	    __sync_fetch_and_add(&numUnrepairable, 1);
+	    Problem("%s: sector %d is also used by the file whose header "
+		"is at %d", job->path, sectors[i], owner[sectors[i]]);
+	}
+    delete [] sectors;
+
+    pthread_mutex_lock(&mutex);
+    if (job->isDirectory)
+	numDirectories++;
+    else
+	numFiles++;
+    pthread_mutex_unlock(&mutex);
+    if (verbose)
+	printf("%s: %d bytes, header at %d\n", job->path, hdr.numBytes,
+								job->sector);
+    if (job->isDirectory)
+	CheckDirectory(job, &hdr);
+    delete [] job->path;
+    delete job;
+}
+
+//----------------------------------------------------------------------
+// Worker
+// 	The body of each checking thread: check headers from the queue
+//	until it is empty and no other thread is checking a directory
+//	(which might add more).
+//----------------------------------------------------------------------
+
+static void *
+Worker(void *)
+{
+    Job *job;
+
+    pthread_mutex_lock(&mutex);
+    for (;;) {
+	while ((queue == NULL) && (pending > 0))
+	    pthread_cond_wait(&moreWork, &mutex);
+	if (queue == NULL)
+	    break;			// all done
+	job = queue;
+	queue = job->next;
+	pthread_mutex_unlock(&mutex);
+
+	CheckFile(job);
+
+	pthread_mutex_lock(&mutex);
+	if (--pending == 0)
+	    pthread_cond_broadcast(&moreWork);
+    }
+    pthread_mutex_unlock(&mutex);
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// RemoveEntries
+// 	Take the entries for the headers that were no good out of their
+//	directories.  The entries are marked as removed, not just unused,
+//	so that lookups still probe past them.
+//----------------------------------------------------------------------
+
+static void
+RemoveEntries()
+{
+    DirectoryEntry entry;
+    FileHeader dirHdr;
+
+    while (dropped != NULL) {
+	Job *job = dropped;
+
+	dropped = job->next;
+	memcpy(&dirHdr, Sector(job->parentSector), sizeof(dirHdr));
+	FileBytes(&dirHdr, job->entryIndex * sizeof(DirectoryEntry),
+			(char *) &entry, sizeof(DirectoryEntry), false);
+	entry.inUse = false;
+	entry.deleted = true;
+	FileBytes(&dirHdr, job->entryIndex * sizeof(DirectoryEntry),
+			(char *) &entry, sizeof(DirectoryEntry), true);
+	printf("Removed %s\n", job->path);
+	delete [] job->path;
+	delete job;
+    }
+}
+
+//----------------------------------------------------------------------
+// CheckFreeMap
+// 	Compare the bitmap of free sectors with the sectors we found to
+//	be in use.  If repairing, make the bitmap match.  Bits past the
+//	end of the disk are kept set, as Nachos expects.
+//----------------------------------------------------------------------
+
+static void
+CheckFreeMap()
+{
+    FileHeader mapHdr;
+    int numWords = divRoundUp(numSectors, BitsInWord);
+    unsigned int *map = new unsigned int[numWords];
+    int numUsed = 0, numLeaked = 0, numLost = 0;
+
+    memcpy(&mapHdr, Sector(FreeMapSector), sizeof(mapHdr));
+    if (owner[FreeMapSector] != FreeMapSector) {
+	Problem("Can't check the bitmap, its header is bad");
+	delete [] map;
+	return;
+    }
+    if (mapHdr.numBytes < (int) (numWords * sizeof(unsigned int))) {
+	Problem("The bitmap file is too short (%d bytes) for the disk",
+							mapHdr.numBytes);
+	delete [] map;
+	return;
+    }
+    FileBytes(&mapHdr, 0, (char *) map, numWords * sizeof(unsigned int),
+									false);
+
+    for (int i = 0; i < numSectors; i++) {
+	bool marked = (map[i / BitsInWord] >> (i % BitsInWord)) & 1;
+	bool used = (owner[i] != Unused);
+
+	if (used)
+	    numUsed++;
+	if (used && !marked) {
+	    numLost++;
+	    if (verbose || numLost <= 10)
+		printf("Sector %d is in use, but marked free\n", i);
+	} else if (!used && marked) {
+	    numLeaked++;
+	    if (verbose || numLeaked <= 10)
+		printf("Sector %d is marked in use, but nothing uses it\n", i);
+	}
+	if (used)
+	    map[i / BitsInWord] |= 1u << (i % BitsInWord);
+	else
+	    map[i / BitsInWord] &= ~(1u << (i % BitsInWord));
+    }
+    for (int i = numSectors; i < numWords * BitsInWord; i++)
+	map[i / BitsInWord] |= 1u << (i % BitsInWord);
+
+    if (numLost > 0)
+	Problem("%d sectors in use are marked free", numLost);
+    if (numLeaked > 0)
+	Problem("%d sectors are leaked", numLeaked);
+    if (repair && (numLost > 0 || numLeaked > 0)) {
+	FileBytes(&mapHdr, 0, (char *) map, numWords * sizeof(unsigned int),
+									true);
+	printf("Rewrote the bitmap\n");
+    }
+    printf("%d of %d sectors in use\n", numUsed, numSectors);
+    delete [] map;
+}
+
+//----------------------------------------------------------------------
+// main
+// 	Check the disk named on the command line.
+//
+//	Usage: fsck [-r] [-v] [-j threads] disk
+//
+//	   -r repairs what can be repaired
+//	   -v lists every file, and every bad sector
+//	   -j sets the number of checking threads (by default, one per
+//		processor)
+//
+//	Exit with 0 if the file system is fine (or was repaired), 1 if
+//	there is something wrong with it that is left unrepaired, and 2 if
+//	it couldn't be checked.
+//----------------------------------------------------------------------
+
+int
+main(int argc, char **argv)
+{
+    int numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *threads;
+    int c;
+
+    while ((c = getopt(argc, argv, "rvj:")) != -1) {
+	switch (c) {
+	  case 'r':
+	    repair = true;
+	    break;
+	  case 'v':
+	    verbose = true;
+	    break;
+	  case 'j':
+	    numThreads = atoi(optarg);
+	    break;
+	  default:
+	    fprintf(stderr, "Usage: fsck [-r] [-v] [-j threads] disk\n");
+	    exit(2);
+	}
+    }
+    if ((optind != argc - 1) || (numThreads < 1)) {
+	fprintf(stderr, "Usage: fsck [-r] [-v] [-j threads] disk\n");
+	exit(2);
+    }
+    diskName = argv[optind];
+    if (!LoadDisk())
+	exit(2);
+
+    ReplayLog();
+    AddJob(FreeMapSector, false, strcpy(new char[11], "(free map)"), -1, 0);
+    AddJob(DirectorySector, true, strcpy(new char[2], "/"), -1, 0);
+    threads = new pthread_t[numThreads];
+    for (int i = 0; i < numThreads; i++)
+	pthread_create(&threads[i], NULL, Worker, NULL);
+    for (int i = 0; i < numThreads; i++)
+	pthread_join(threads[i], NULL);
+    printf("%d files, %d directories\n", numFiles, numDirectories);
+
+    RemoveEntries();
+    CheckFreeMap();
+    if (repair)
+	SaveDisk();
+    close(diskFile);
+
+    if (numProblems == 0) {
+	printf("%s is clean\n", diskName);
+	return 0;
+    }
+    printf("%d problems found%s\n", numProblems, repair ? ", and repaired"
+					" where possible" : "");
+    return (repair && numUnrepairable == 0) ? 0 : 1;
+}